@@ -0,0 +1,666 @@
+/*  Ghostbusters The Video Game Texture Kernel Benchmark
+	Copyright 2025 KeyofBlueS
+
+	The Ghostbusters The Video Game Texture Kernel Benchmark is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <random>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "../libgbtex/gbtex.h"
+#include "gbtex-verify.h"
+
+using namespace gbtex;
+
+const std::string version = "v0.1.0";
+bool quiet = false;	// Quiet mode flag
+
+// Every allocation of the process is counted, so that each measurement can report its own
+std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+	++allocations;
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	std::free(p);
+}
+
+// Swizzled TEX formats, with the platform dds2tex writes them for
+struct BenchFormat {
+	DWORD texFormat;
+	const char* platform;
+};
+
+const BenchFormat formats[] = {
+	{ 0x27, "ps3" },	// A8R8G8B8
+	{ 0x26, "ps3" },	// A8R8G8B8 cubemap
+	{ 0x31, "ps3" },	// A8L8
+	{ 0x16, "xbox360" },	// R8G8B8A8
+	{ 0x36, "xbox360" },	// A8R8G8B8 cubemap
+	{ 0x28, "xbox360" },	// DXT1
+	{ 0x30, "xbox360" },	// A8L8
+	{ 0x33, "xbox360" },	// DXT5
+	{ 0x41, "switch" },	// R8G8B8A8
+};
+
+// Result of a single measurement
+struct BenchResult {
+	std::string name;		// Kernel or conversion
+	DWORD texFormat = 0;
+	std::string platform;
+	int width = 0;
+	int height = 0;
+	size_t bytes = 0;		// Linear (DDS) bytes processed per call
+	double mbPerSecond = 0;
+	double nsPerPixel = 0;
+	double allocations = 0;	// Allocations per call
+};
+
+// Function to print the help message
+void printHelpMessage() {
+	std::cout << std::endl;
+	std::cout << "👻 GBTVGR Texture Kernel Benchmark " << version << std::endl;
+	std::cout << std::endl;
+	std::cout << "Usage: gbtex-bench [options]" << std::endl;
+	std::cout << "       gbtex-bench --verify [options]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -s, --sizes <n,n,...>			Side lengths in pixels of the synthetic textures. Default is 256,1024,4096." << std::endl;
+	std::cout << "  -f, --filter <text>			Only run the kernels and conversions whose name contains <text>." << std::endl;
+	std::cout << "  -t, --time <ms>			Minimum time spent on each measurement. Default is 200." << std::endl;
+	std::cout << "  -j, --threads <n>			Number of threads used by the kernels. Default is 1." << std::endl;
+	std::cout << "  -o, --output <results.json>		Save the results to <results.json>." << std::endl;
+	std::cout << "  -c, --compare <baseline.json>		Compare the results with those saved in <baseline.json>." << std::endl;
+	std::cout << "  -v, --verify				Check the kernels against reference kernels and their own round trips instead." << std::endl;
+	std::cout << "  -n, --cases <n>			Number of random kernel configurations checked by --verify. Default is 500." << std::endl;
+	std::cout << "  -S, --seed <n>			Seed of the random configurations and payloads of --verify. Default is 1." << std::endl;
+	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
+	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
+	std::cout << std::endl;
+	std::cout << std::endl;
+	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
+	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
+	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
+	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
+}
+
+// Function to format a TEX format code as in the TEX format tables
+std::string formatCode(DWORD texFormat) {
+	std::stringstream code;
+	code << "0x" << std::hex << std::setw(2) << std::setfill('0') << texFormat;
+	return code.str();
+}
+
+// Function to build a synthetic TEX file of <width> x <height> pixels with a single mip level and random texels
+std::vector<uint8_t> buildTexFile(DWORD texFormat, int width, int height, size_t payloadSize, std::mt19937& random) {
+	TEX_Header texHeader;
+	texHeader.dwFormat = texFormat;
+	texHeader.dwWidth = width;
+	texHeader.dwHeight = height;
+
+	std::vector<uint8_t> texFile(sizeof(TEX_Header) + payloadSize);
+	std::memcpy(texFile.data(), &texHeader, sizeof(TEX_Header));
+	for (size_t i = sizeof(TEX_Header); i < texFile.size(); ++i) {
+		texFile[i] = static_cast<uint8_t>(random());
+	}
+	return texFile;
+}
+
+// Function to get the DDS pixel format and number of faces tex2dds writes for a TEX format, from the
+// conversion of a tiny texture (with room for six faces of Nintendo Switch GOBs)
+bool probePixelFormat(DWORD texFormat, DDS_PIXELFORMAT& ddspf, int& faces) {
+	std::mt19937 random(0);
+	std::vector<uint8_t> texFile = buildTexFile(texFormat, 4, 4, 6 * 512, random);
+	std::vector<uint8_t> ddsFile;
+	std::string error;
+	if (convertTexToDds(ByteSpan{texFile.data(), texFile.size()}, ddsFile, TexToDdsOptions(), error) != 0) {
+		return false;
+	}
+	DDS_HEADER ddsHeader;
+	std::memcpy(&ddsHeader, ddsFile.data() + sizeof(DWORD), sizeof(DDS_HEADER));
+	ddspf = ddsHeader.ddspf;
+	faces = ddsHeader.dwCubemapFlags ? 6 : 1;
+	return true;
+}
+
+// Function to time <run>, calling it until <minTime> has passed
+// Returns the mean time of a call in nanoseconds and the mean number of allocations it made.
+template <typename Run>
+void measure(const Run& run, std::chrono::milliseconds minTime, double& nsPerCall, double& allocationsPerCall) {
+	typedef std::chrono::steady_clock Clock;
+	run();	// Warm up caches and the kernel tables
+
+	uint64_t calls = 0;
+	uint64_t allocationsBefore = allocations.load();
+	Clock::time_point start = Clock::now();
+	Clock::duration elapsed;
+	do {
+		run();
+		++calls;
+		elapsed = Clock::now() - start;
+	} while (elapsed < minTime);
+
+	nsPerCall = std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+	allocationsPerCall = static_cast<double>(allocations.load() - allocationsBefore) / calls;
+}
+
+// Function to benchmark the kernels and conversions of a TEX format at one size
+void benchFormat(const BenchFormat& format, int size, const std::string& filter, std::chrono::milliseconds minTime, unsigned int threads, std::vector<BenchResult>& results) {
+	DDS_PIXELFORMAT ddspf;
+	int faces;
+	if (!probePixelFormat(format.texFormat, ddspf, faces)) {
+		std::cerr << "* ERROR: Unsupported TEX format: " << formatCode(format.texFormat) << std::endl;
+		return;
+	}
+
+	const SwizzleInfo swizzle = getSwizzleInfo(format.texFormat);
+	int blockPixelSize;
+	int bytesPerBlock;
+	getBlockInfo(ddspf, blockPixelSize, bytesPerBlock);
+	const Subresource sub = planSurfaceLayout(size, size, 1, 1, blockPixelSize, bytesPerBlock, swizzle.type, swizzle.blockHeight).front();
+
+	std::mt19937 random(format.texFormat);
+	std::vector<uint8_t> texFile = buildTexFile(format.texFormat, size, size, sub.tiledSize * faces, random);
+	const uint8_t* tiled = texFile.data() + sizeof(TEX_Header);
+	std::vector<uint8_t> linear(sub.linearSize);
+	std::vector<uint8_t> retiled(sub.tiledSize);
+
+	// Conversions go through every face of a cubemap, kernels through one
+	auto record = [&](const std::string& name, double nsPerCall, double allocationsPerCall, int surfaces) {
+		BenchResult result;
+		result.name = name;
+		result.texFormat = format.texFormat;
+		result.platform = format.platform;
+		result.width = size;
+		result.height = size;
+		result.bytes = sub.linearSize * surfaces;
+		result.mbPerSecond = result.bytes / (nsPerCall / 1e9) / (1024.0 * 1024.0);
+		result.nsPerPixel = nsPerCall / (static_cast<double>(size) * size * surfaces);
+		result.allocations = allocationsPerCall;
+		results.push_back(result);
+
+		if (!quiet) {
+			std::cout << std::left << std::setw(20) << name << std::setw(6) << formatCode(format.texFormat)
+					  << std::setw(9) << format.platform << std::right << std::setw(12) << (std::to_string(size) + "x" + std::to_string(size))
+					  << std::fixed << std::setprecision(1) << std::setw(11) << result.mbPerSecond
+					  << std::setprecision(3) << std::setw(11) << result.nsPerPixel
+					  << std::setprecision(1) << std::setw(9) << result.allocations << std::endl;
+		}
+	};
+
+	double nsPerCall;
+	double allocationsPerCall;
+	const std::string unswizzleName = "unswizzle_" + swizzle.type;
+	const std::string swizzleName = "swizzle_" + swizzle.type;
+	const int alignedWidth = (sub.width + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+	const int alignedHeight = (sub.height + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+
+	// Kernels, called on the first mip level as convertTexToDds / convertDdsToTex do
+	if (unswizzleName.find(filter) != std::string::npos) {
+		measure([&]() {
+			if (swizzle.type == "x360") {
+				unswizzle_x360(tiled, sub.tiledSize, linear.data(), linear.size(), alignedWidth, alignedHeight, swizzle.blockPixelSize, swizzle.texelBytePitch, swizzle.convertToRGBA ? X360_SWAP16_ARGB_TO_RGBA : X360_SWAP16, threads);
+			} else if (swizzle.type == "morton") {
+				unswizzle_morton(tiled, sub.tiledSize, linear.data(), linear.size(), sub.width, sub.height, bytesPerBlock, swizzle.blockWidthHeight, threads);
+			} else if (swizzle.type == "switch") {
+				unswizzle_switch(tiled, sub.tiledSize, linear.data(), linear.size(), sub.width, sub.height, swizzle.bytesPerBlock, sub.blockHeight, threads);
+			}
+		}, minTime, nsPerCall, allocationsPerCall);
+		record(unswizzleName, nsPerCall, allocationsPerCall, 1);
+	}
+	if (swizzleName.find(filter) != std::string::npos) {
+		measure([&]() {
+			if (swizzle.type == "x360") {
+				swizzle_x360(linear.data(), linear.size(), retiled.data(), retiled.size(), alignedWidth, alignedHeight, swizzle.blockPixelSize, swizzle.texelBytePitch, swizzle.convertToRGBA ? X360_SWAP16_RGBA_TO_ARGB : X360_SWAP16, threads);
+			} else if (swizzle.type == "morton") {
+				swizzle_morton(linear.data(), linear.size(), retiled.data(), retiled.size(), sub.width, sub.height, bytesPerBlock, swizzle.blockWidthHeight, threads);
+			} else if (swizzle.type == "switch") {
+				swizzle_switch(linear.data(), linear.size(), retiled.data(), retiled.size(), sub.width, sub.height, swizzle.bytesPerBlock, sub.blockHeight, threads);
+			}
+		}, minTime, nsPerCall, allocationsPerCall);
+		record(swizzleName, nsPerCall, allocationsPerCall, 1);
+	}
+
+	// Whole conversions, including the header handling and output allocation
+	std::vector<uint8_t> ddsFile;
+	std::string error;
+	TexToDdsOptions texToDds;
+	texToDds.threads = threads;
+	if (convertTexToDds(ByteSpan{texFile.data(), texFile.size()}, ddsFile, texToDds, error) != 0) {
+		std::cerr << "* ERROR: " << error << std::endl;
+		return;
+	}
+	if (std::string("convertTexToDds").find(filter) != std::string::npos) {
+		measure([&]() {
+			std::vector<uint8_t> output;
+			convertTexToDds(ByteSpan{texFile.data(), texFile.size()}, output, texToDds, error);
+		}, minTime, nsPerCall, allocationsPerCall);
+		record("convertTexToDds", nsPerCall, allocationsPerCall, faces);
+	}
+	if (std::string("convertDdsToTex").find(filter) != std::string::npos) {
+		DdsToTexOptions ddsToTex;
+		ddsToTex.platform = format.platform;
+		ddsToTex.threads = threads;
+		measure([&]() {
+			std::vector<uint8_t> output;
+			convertDdsToTex(ByteSpan{ddsFile.data(), ddsFile.size()}, output, ddsToTex, error);
+		}, minTime, nsPerCall, allocationsPerCall);
+		record("convertDdsToTex", nsPerCall, allocationsPerCall, faces);
+	}
+
+	// The same conversion with its output taken from a pool, as in a batch or the conversion server
+	if (std::string("pooledTexToDds").find(filter) != std::string::npos) {
+		BufferPool pool;
+		measure([&]() {
+			std::vector<uint8_t> output = pool.acquire();
+			convertTexToDds(ByteSpan{texFile.data(), texFile.size()}, output, texToDds, error);
+			pool.release(output);
+		}, minTime, nsPerCall, allocationsPerCall);
+		record("pooledTexToDds", nsPerCall, allocationsPerCall, faces);
+	}
+}
+
+// Function to draw a random kernel configuration
+VerifyCase randomCase(std::mt19937& random) {
+	const int sides[] = { 1, 2, 3, 4, 5, 7, 8, 12, 16, 31, 32, 33, 63, 64, 65, 96, 100, 128, 255, 256, 257 };
+	auto pick = [&random](int count) { return static_cast<int>(random() % count); };
+
+	VerifyCase verifyCase;
+	switch (pick(3)) {
+	case 0: {
+		const int pitches[] = { 2, 4, 8, 16 };
+		verifyCase.type = "x360";
+		verifyCase.bytesPerBlock = pitches[pick(4)];
+		verifyCase.blockPixelSize = verifyCase.bytesPerBlock >= 8 && pick(2) ? 4 : 1;
+		if (verifyCase.bytesPerBlock == 4 && pick(2)) {
+			verifyCase.swizzleOrder = X360_SWAP16_RGBA_TO_ARGB;
+			verifyCase.unswizzleOrder = X360_SWAP16_ARGB_TO_RGBA;
+		}
+		break;
+	}
+	case 1: {
+		const int bytes[] = { 1, 2, 3, 4, 8, 16 };
+		verifyCase.type = "morton";
+		verifyCase.bytesPerBlock = bytes[pick(6)];
+		verifyCase.blockPixelSize = pick(4) ? 1 : 2;
+		break;
+	}
+	default: {
+		const int bytes[] = { 1, 2, 4, 8, 16 };
+		verifyCase.type = "switch";
+		verifyCase.bytesPerBlock = bytes[pick(5)];
+		verifyCase.blockHeight = 1 << pick(5);
+		break;
+	}
+	}
+
+	// Sides are whole blocks, as convertTexToDds / convertDdsToTex align them
+	verifyCase.width = std::max(1, sides[pick(21)] / verifyCase.blockPixelSize) * verifyCase.blockPixelSize;
+	verifyCase.height = std::max(1, sides[pick(21)] / verifyCase.blockPixelSize) * verifyCase.blockPixelSize;
+	return verifyCase;
+}
+
+// Function to check one configuration with random payloads, full or truncated
+bool verifyKernels(const VerifyCase& verifyCase, std::mt19937& random, unsigned int threads) {
+	auto randomBytes = [&random](size_t size) {
+		std::vector<uint8_t> bytes(size);
+		for (auto& byte : bytes) {
+			byte = static_cast<uint8_t>(random());
+		}
+		return bytes;
+	};
+	auto truncated = [&random](size_t size) {
+		size_t cut = random() % 3 == 0 ? random() % (size + 1) : size;
+		return cut - cut % 2;	// The Xbox 360 kernels need whole 16-bit words
+	};
+
+	VerifyPayload payload;
+	payload.tiled = randomBytes(verifyCase.tiledSize());
+	payload.linear = randomBytes(verifyCase.linearSize());
+	payload.tiledInputSize = truncated(payload.tiled.size());
+	payload.linearOutputSize = truncated(payload.linear.size());
+	payload.linearInputSize = truncated(payload.linear.size());
+	payload.tiledOutputSize = truncated(payload.tiled.size());
+	return verifyKernels(verifyCase, payload, threads);
+}
+
+// Function to check that surfaces large enough to be split into bands convert the same on several threads
+bool verifyBands(const VerifyCase& verifyCase, std::mt19937& random, unsigned int threads) {
+	std::vector<uint8_t> input(std::max(verifyCase.linearSize(), verifyCase.tiledSize()));
+	for (auto& byte : input) {
+		byte = static_cast<uint8_t>(random());
+	}
+
+	bool ok = true;
+	std::vector<uint8_t> single(verifyCase.linearSize());
+	std::vector<uint8_t> banded(single.size());
+	verifyCase.unswizzle(input.data(), verifyCase.tiledSize(), single.data(), single.size(), 1);
+	verifyCase.unswizzle(input.data(), verifyCase.tiledSize(), banded.data(), banded.size(), threads);
+	ok &= sameOutput(banded, single, "threaded unswizzle_" + verifyCase.type, verifyCase);
+
+	single.assign(verifyCase.tiledSize(), 0);
+	banded.assign(single.size(), 0);
+	verifyCase.swizzle(input.data(), verifyCase.linearSize(), single.data(), single.size(), 1);
+	verifyCase.swizzle(input.data(), verifyCase.linearSize(), banded.data(), banded.size(), threads);
+	ok &= sameOutput(banded, single, "threaded swizzle_" + verifyCase.type, verifyCase);
+
+	return ok;
+}
+
+// Function to run the verification: <cases> random configurations drawn from <seed>, then the large surfaces
+// Returns the number of failed configurations.
+size_t runVerification(size_t cases, uint32_t seed, unsigned int threads) {
+	std::mt19937 random(seed);
+	size_t failures = 0;
+
+	for (size_t i = 0; i < cases; ++i) {
+		VerifyCase verifyCase = randomCase(random);
+		if (!verifyKernels(verifyCase, random, threads)) {
+			++failures;
+		}
+	}
+
+	// Surfaces of several MB, split into bands even with odd sides
+	const char* types[] = { "x360", "morton", "switch" };
+	const int sides[][2] = { { 2048, 2048 }, { 1536, 1000 }, { 1001, 1999 } };
+	for (const char* type : types) {
+		for (const auto& side : sides) {
+			VerifyCase verifyCase;
+			verifyCase.type = type;
+			verifyCase.width = side[0];
+			verifyCase.height = side[1];
+			verifyCase.blockHeight = 16;
+			if (!verifyBands(verifyCase, random, std::max(2u, threads))) {
+				++failures;
+			}
+		}
+	}
+
+	if (!quiet) std::cout << "Verification complete: " << cases << " random configurations (seed " << seed << "), " << failures << " failed." << std::endl;
+	return failures;
+}
+
+// Function to identify a measurement across runs
+std::string resultKey(const BenchResult& result) {
+	return result.name + " " + formatCode(result.texFormat) + " " + result.platform + " " + std::to_string(result.width) + "x" + std::to_string(result.height);
+}
+
+// Function to save the results as JSON, one result per line
+bool saveResults(const std::string& filePath, const std::vector<BenchResult>& results, unsigned int threads) {
+	std::ofstream file(filePath);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "{\n";
+	file << "  \"tool\": \"gbtex-bench " << version << "\",\n";
+	file << "  \"threads\": " << threads << ",\n";
+	file << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchResult& result = results[i];
+		file << "    {\"name\": \"" << result.name << "\", \"format\": \"" << formatCode(result.texFormat)
+			 << "\", \"platform\": \"" << result.platform << "\", \"width\": " << result.width << ", \"height\": " << result.height
+			 << ", \"bytes\": " << result.bytes << std::fixed << std::setprecision(3)
+			 << ", \"mb_per_s\": " << result.mbPerSecond << ", \"ns_per_pixel\": " << result.nsPerPixel
+			 << ", \"allocations\": " << result.allocations << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n";
+	file << "}\n";
+
+	file.close();
+	return !file.fail();
+}
+
+// Function to get a field of a result line written by saveResults()
+std::string jsonField(const std::string& line, const std::string& field) {
+	std::string marker = "\"" + field + "\": ";
+	size_t start = line.find(marker);
+	if (start == std::string::npos) {
+		return "";
+	}
+	start += marker.size();
+	if (line[start] == '"') {
+		return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+	}
+	return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+// Function to load the results saved by a previous run
+bool loadResults(const std::string& filePath, std::map<std::string, BenchResult>& baseline) {
+	std::ifstream file(filePath);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.find("\"name\": ") == std::string::npos) {
+			continue;
+		}
+		try {
+			BenchResult result;
+			result.name = jsonField(line, "name");
+			result.texFormat = static_cast<DWORD>(std::stoul(jsonField(line, "format"), nullptr, 16));
+			result.platform = jsonField(line, "platform");
+			result.width = std::stoi(jsonField(line, "width"));
+			result.height = std::stoi(jsonField(line, "height"));
+			result.mbPerSecond = std::stod(jsonField(line, "mb_per_s"));
+			result.nsPerPixel = std::stod(jsonField(line, "ns_per_pixel"));
+			result.allocations = std::stod(jsonField(line, "allocations"));
+			baseline[resultKey(result)] = result;
+		} catch (const std::exception&) {
+			continue;
+		}
+	}
+	return true;
+}
+
+// Function to print the speed of every result relative to the baseline
+void printComparison(const std::vector<BenchResult>& results, const std::map<std::string, BenchResult>& baseline) {
+	std::cout << std::endl;
+	std::cout << std::left << std::setw(47) << "Compared with baseline" << std::right << std::setw(11) << "speedup" << std::setw(11) << "allocs" << std::endl;
+	for (const BenchResult& result : results) {
+		auto it = baseline.find(resultKey(result));
+		if (it == baseline.end() || it->second.mbPerSecond <= 0) {
+			continue;
+		}
+		std::cout << std::left << std::setw(47) << resultKey(result) << std::right << std::fixed
+				  << std::setprecision(2) << std::setw(10) << result.mbPerSecond / it->second.mbPerSecond << "x"
+				  << std::setprecision(1) << std::setw(11) << (result.allocations - it->second.allocations) << std::endl;
+	}
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	std::vector<int> sizes = { 256, 1024, 4096 };
+	std::string filter;
+	std::chrono::milliseconds minTime(200);
+	unsigned int threads = 1;
+	std::string outputFile;
+	std::string baselineFile;
+	bool verify = false;
+	size_t cases = 500;
+	uint32_t seed = 1;
+	bool argError = false;
+
+	// Define the long options for getopt
+	struct option long_options[] = {
+		{"sizes", required_argument, nullptr, 's'},
+		{"filter", required_argument, nullptr, 'f'},
+		{"time", required_argument, nullptr, 't'},
+		{"threads", required_argument, nullptr, 'j'},
+		{"output", required_argument, nullptr, 'o'},
+		{"compare", required_argument, nullptr, 'c'},
+		{"verify", no_argument, nullptr, 'v'},
+		{"cases", required_argument, nullptr, 'n'},
+		{"seed", required_argument, nullptr, 'S'},
+		{"quiet", no_argument, nullptr, 'q'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0}	// Terminate the list of options
+	};
+
+	// Parse command-line arguments
+	int opt;
+	int option_index = 0;
+	while ((opt = getopt_long(argc, argv, "s:f:t:j:o:c:vn:S:qh", long_options, &option_index)) != -1) {
+		switch (opt) {
+			case 's': {
+				sizes.clear();
+				std::stringstream list(optarg);
+				std::string size;
+				while (std::getline(list, size, ',')) {
+					try {
+						sizes.push_back(std::stoi(size));
+					} catch (const std::exception&) {
+						argError = true;
+						std::cerr << "* ERROR: Invalid size: " << size << std::endl;
+					}
+				}
+				break;
+			}
+			case 'f':
+				filter = optarg;
+				break;
+			case 't':
+				try {
+					minTime = std::chrono::milliseconds(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid time: " << optarg << std::endl;
+				}
+				break;
+			case 'j':
+				try {
+					threads = static_cast<unsigned int>(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid number of threads: " << optarg << std::endl;
+				}
+				break;
+			case 'o':
+				outputFile = optarg;
+				break;
+			case 'c':
+				baselineFile = optarg;
+				break;
+			case 'v':
+				verify = true;
+				break;
+			case 'n':
+				try {
+					cases = std::stoul(optarg);
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid number of cases: " << optarg << std::endl;
+				}
+				break;
+			case 'S':
+				try {
+					seed = static_cast<uint32_t>(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid seed: " << optarg << std::endl;
+				}
+				break;
+			case 'q':
+				quiet = true;
+				break;
+			case 'h':
+				printHelpMessage();
+				return 0;
+			case '?':
+			default:
+				argError = true;
+		}
+	}
+
+	for (int i = optind; i < argc; ++i) {
+		argError = true;
+		std::cerr << "* ERROR: Unexpected argument: " << argv[i] << std::endl;
+	}
+
+	for (int size : sizes) {
+		if (size < 1) {
+			argError = true;
+			std::cerr << "* ERROR: Invalid size: " << size << std::endl;
+		}
+	}
+
+	if (argError) {
+		printHelpMessage();
+		return 1;
+	}
+
+	if (verify) {
+		return runVerification(cases, seed, threads) == 0 ? 0 : 1;
+	}
+
+	std::map<std::string, BenchResult> baseline;
+	if (!baselineFile.empty() && !loadResults(baselineFile, baseline)) {
+		std::cerr << "* ERROR: Unable to open baseline: " << baselineFile << std::endl;
+		return 1;
+	}
+
+	if (!quiet) {
+		std::cout << std::left << std::setw(20) << "kernel" << std::setw(6) << "fmt" << std::setw(9) << "platform"
+				  << std::right << std::setw(12) << "size" << std::setw(11) << "MB/s" << std::setw(11) << "ns/pixel" << std::setw(9) << "allocs" << std::endl;
+	}
+
+	std::vector<BenchResult> results;
+	for (const BenchFormat& format : formats) {
+		for (int size : sizes) {
+			benchFormat(format, size, filter, minTime, threads, results);
+		}
+	}
+
+	if (!outputFile.empty() && !saveResults(outputFile, results, threads)) {
+		std::cerr << "* ERROR: Unable to write results: " << outputFile << std::endl;
+		return 1;
+	}
+
+	if (!baseline.empty()) {
+		printComparison(results, baseline);
+	}
+
+	return 0;
+}
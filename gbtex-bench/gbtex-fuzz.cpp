@@ -0,0 +1,212 @@
+/*  Ghostbusters The Video Game Texture Fuzzer
+	Copyright 2025 KeyofBlueS
+
+	The Ghostbusters The Video Game Texture Fuzzer is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+// libFuzzer target: the first byte of every input picks what the rest is fed to
+// 0: a kernel configuration and its payloads, checked against the reference kernels and round trips of gbtex-verify.h
+// 1: a TEX file, converted to DDS and back
+// 2: a DDS file, converted to TEX and back
+// Every conversion runs both in memory and streamed, and both must give the same file.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#include "../libgbtex/gbtex.h"
+#include "gbtex-verify.h"
+
+using namespace gbtex;
+
+// Reader of a fuzz input: configuration bytes first, then the rest as payload
+class FuzzInput {
+public:
+	FuzzInput(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	// Function to take the next byte, 0 once the input is exhausted
+	uint8_t byte() {
+		return offset < size ? data[offset++] : 0;
+	}
+
+	// Function to take a value below <count>
+	int pick(int count) {
+		return byte() % count;
+	}
+
+	// Function to take a 16-bit value
+	size_t word() {
+		size_t low = byte();
+		return low | static_cast<size_t>(byte()) << 8;
+	}
+
+	// Function to get the rest of the input
+	ByteSpan rest() const {
+		return ByteSpan{data + offset, size - offset};
+	}
+
+	// Function to get <count> payload bytes, the rest of the input repeated (zeros if nothing is left)
+	std::vector<uint8_t> payload(size_t count) const {
+		std::vector<uint8_t> bytes(count, 0);
+		if (offset < size) {
+			for (size_t i = 0; i < count; ++i) {
+				bytes[i] = data[offset + i % (size - offset)];
+			}
+		}
+		return bytes;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t offset = 0;
+};
+
+// Function to draw a kernel configuration from the input, over the same ranges as gbtex-bench --verify
+// Sides go from 1 to 257 pixels, in whole blocks.
+VerifyCase fuzzCase(FuzzInput& input) {
+	VerifyCase verifyCase;
+	switch (input.pick(3)) {
+	case 0: {
+		const int pitches[] = { 2, 4, 8, 16 };
+		verifyCase.type = "x360";
+		verifyCase.bytesPerBlock = pitches[input.pick(4)];
+		verifyCase.blockPixelSize = verifyCase.bytesPerBlock >= 8 && input.pick(2) ? 4 : 1;
+		if (verifyCase.bytesPerBlock == 4 && input.pick(2)) {
+			verifyCase.swizzleOrder = X360_SWAP16_RGBA_TO_ARGB;
+			verifyCase.unswizzleOrder = X360_SWAP16_ARGB_TO_RGBA;
+		}
+		break;
+	}
+	case 1: {
+		const int bytes[] = { 1, 2, 3, 4, 8, 16 };
+		verifyCase.type = "morton";
+		verifyCase.bytesPerBlock = bytes[input.pick(6)];
+		verifyCase.blockPixelSize = input.pick(4) ? 1 : 2;
+		break;
+	}
+	default: {
+		const int bytes[] = { 1, 2, 4, 8, 16 };
+		verifyCase.type = "switch";
+		verifyCase.bytesPerBlock = bytes[input.pick(5)];
+		verifyCase.blockHeight = 1 << input.pick(5);
+		break;
+	}
+	}
+
+	verifyCase.width = std::max<int>(1, (1 + input.word() % 257) / verifyCase.blockPixelSize) * verifyCase.blockPixelSize;
+	verifyCase.height = std::max<int>(1, (1 + input.word() % 257) / verifyCase.blockPixelSize) * verifyCase.blockPixelSize;
+	return verifyCase;
+}
+
+// Function to check the kernels of a configuration drawn from the input, on payloads made of the rest of it
+bool fuzzKernels(FuzzInput& input) {
+	VerifyCase verifyCase = fuzzCase(input);
+	auto truncated = [&input](size_t size) {
+		size_t cut = input.pick(3) == 0 ? input.word() * 64 % (size + 1) : size;
+		return cut - cut % 2;	// The Xbox 360 kernels need whole 16-bit words
+	};
+
+	VerifyPayload payload;
+	payload.tiledInputSize = truncated(verifyCase.tiledSize());
+	payload.linearOutputSize = truncated(verifyCase.linearSize());
+	payload.linearInputSize = truncated(verifyCase.linearSize());
+	payload.tiledOutputSize = truncated(verifyCase.tiledSize());
+	payload.tiled = input.payload(verifyCase.tiledSize());
+	payload.linear = input.payload(verifyCase.linearSize());
+	return verifyKernels(verifyCase, payload, 1);
+}
+
+// Function to convert a TEX file to DDS both in memory and streamed
+// Returns false if the two conversions disagree, with <converted> set when they both succeeded.
+bool fuzzTexToDds(ByteSpan tex, std::vector<uint8_t>& dds, bool& converted) {
+	TexToDdsOptions options;
+	options.threads = 1;
+	std::string error;
+	int result = convertTexToDds(tex, dds, options, error);
+
+	std::vector<uint8_t> streamed;
+	int streamedResult = streamTexToDds(tex, [&streamed](ByteSpan part) {
+		streamed.insert(streamed.end(), part.data, part.data + part.size);
+		return true;
+	}, options, error);
+
+	converted = result == 0;
+	if (result != streamedResult || (converted && streamed != dds)) {
+		std::cerr << "* ERROR: convertTexToDds and streamTexToDds differ (" << result << ", " << streamedResult << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Function to convert a DDS file to TEX for <platform> both in memory and streamed
+bool fuzzDdsToTex(ByteSpan dds, const std::string& platform, std::vector<uint8_t>& tex, bool& converted) {
+	DdsToTexOptions options;
+	options.platform = platform;
+	options.threads = 1;
+	std::string error;
+	int result = convertDdsToTex(dds, tex, options, error);
+
+	std::vector<uint8_t> streamed;
+	int streamedResult = streamDdsToTex(dds, [&streamed](ByteSpan part) {
+		streamed.insert(streamed.end(), part.data, part.data + part.size);
+		return true;
+	}, options, error);
+
+	converted = result == 0;
+	if (result != streamedResult || (converted && streamed != tex)) {
+		std::cerr << "* ERROR: convertDdsToTex and streamDdsToTex differ (" << result << ", " << streamedResult << ") for " << platform << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Function to feed a TEX or DDS file through a conversion and the conversion back of its output
+bool fuzzConversions(FuzzInput& input, bool fromTex) {
+	const char* platforms[] = { "pc", "ps3", "xbox360", "switch" };
+	const std::string platform = platforms[input.pick(4)];
+	const ByteSpan file = input.rest();
+
+	std::vector<uint8_t> tex;
+	std::vector<uint8_t> dds;
+	bool converted = false;
+	if (fromTex) {
+		if (!fuzzTexToDds(file, dds, converted)) {
+			return false;
+		}
+		return !converted || fuzzDdsToTex(ByteSpan{dds.data(), dds.size()}, platform, tex, converted);
+	}
+	if (!fuzzDdsToTex(file, platform, tex, converted)) {
+		return false;
+	}
+	return !converted || fuzzTexToDds(ByteSpan{tex.data(), tex.size()}, dds, converted);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	FuzzInput input(data, size);
+	bool ok;
+	switch (input.pick(3)) {
+	case 0:
+		ok = fuzzKernels(input);
+		break;
+	case 1:
+		ok = fuzzConversions(input, true);
+		break;
+	default:
+		ok = fuzzConversions(input, false);
+		break;
+	}
+
+	// A difference is a finding as much as a crash
+	if (!ok) {
+		std::abort();
+	}
+	return 0;
+}
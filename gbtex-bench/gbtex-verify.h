@@ -0,0 +1,363 @@
+/*  Ghostbusters The Video Game Texture Kernel Verification
+	Copyright 2025 KeyofBlueS
+
+	The Ghostbusters The Video Game Texture Kernel Verification is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+// Reference kernels and kernel checks shared by gbtex-bench --verify and gbtex-fuzz
+
+#ifndef GBTEX_VERIFY_H
+#define GBTEX_VERIFY_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "../libgbtex/gbtex.h"
+
+namespace gbtex {
+
+// Reference kernels
+// Straightforward block by block (byte by byte for the Nintendo Switch) versions of the libgbtex kernels,
+// following the address formulas the original converters used. --verify checks the kernels against them.
+inline int referenceTiledX(int blockOffset, int widthInBlocks, int texelBytePitch) {
+	int alignedWidth = (widthInBlocks + 31) & ~31;
+	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+	int offsetByte = blockOffset << logBpp;
+	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
+	int offsetMacro = offsetTile >> (7 + logBpp);
+
+	int macroX = (offsetMacro % (alignedWidth >> 5)) << 2;
+	int tile = (((offsetTile >> (5 + logBpp)) & 2) + (offsetByte >> 6)) & 3;
+	int macro = (macroX + tile) << 3;
+	int micro = ((((offsetTile >> 1) & ~0xF) + (offsetTile & 0xF)) & ((texelBytePitch << 3) - 1)) >> logBpp;
+
+	return macro + micro;
+}
+
+inline int referenceTiledY(int blockOffset, int widthInBlocks, int texelBytePitch) {
+	int alignedWidth = (widthInBlocks + 31) & ~31;
+	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+	int offsetByte = blockOffset << logBpp;
+	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
+	int offsetMacro = offsetTile >> (7 + logBpp);
+
+	int macroY = (offsetMacro / (alignedWidth >> 5)) << 2;
+	int tile = ((offsetTile >> (6 + logBpp)) & 1) + ((offsetByte & 0x800) >> 10);
+	int macro = (macroY + tile) << 3;
+	int micro = (((offsetTile & (((texelBytePitch << 6) - 1) & ~0x1F)) + ((offsetTile & 0xF) << 1)) >> (3 + logBpp)) & ~1;
+
+	return macro + micro + ((offsetTile & 0x10) >> 4);
+}
+
+// Function to reorder every 16 bytes of <data> as given by <byte_order>, one byte at a time
+inline void referenceShuffle(std::vector<uint8_t>& data, size_t size, const uint8_t* byte_order) {
+	for (size_t offset = 0; offset < size; offset += 16) {
+		uint8_t chunk[16] = {};
+		size_t count = std::min<size_t>(16, size - offset);
+		std::memcpy(chunk, &data[offset], count);
+		for (size_t i = 0; i < count; ++i) {
+			data[offset + i] = chunk[byte_order[i]];
+		}
+	}
+}
+
+inline void reference_unswizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order) {
+	const int widthInBlocks = width / block_pixel_size;
+	const int heightInBlocks = height / block_pixel_size;
+	const size_t T = texel_byte_pitch;
+
+	// Byte order whole texels, as the kernel never shuffles a texel cut by the end of the input
+	std::vector<uint8_t> swapped(input, input + input_size);
+	referenceShuffle(swapped, input_size - input_size % T, byte_order);
+
+	for (int j = 0; j < heightInBlocks; ++j) {
+		for (int i = 0; i < widthInBlocks; ++i) {
+			int blockOffset = j * widthInBlocks + i;
+			size_t x = referenceTiledX(blockOffset, widthInBlocks, texel_byte_pitch);
+			size_t y = referenceTiledY(blockOffset, widthInBlocks, texel_byte_pitch);
+			size_t src = static_cast<size_t>(blockOffset) * T;
+			size_t dst = (y * widthInBlocks + x) * T;
+			if (dst + T <= output_size && src + T <= input_size) {
+				std::memcpy(&output[dst], &swapped[src], T);
+			}
+		}
+	}
+}
+
+inline void reference_swizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order) {
+	const int widthInBlocks = width / block_pixel_size;
+	const int heightInBlocks = height / block_pixel_size;
+	const size_t T = texel_byte_pitch;
+	const size_t totalBlocks = static_cast<size_t>(widthInBlocks) * heightInBlocks;
+
+	std::vector<uint8_t> gathered(totalBlocks * T, 0);
+	for (size_t b = 0; b < totalBlocks; ++b) {
+		size_t x = referenceTiledX(static_cast<int>(b), widthInBlocks, texel_byte_pitch);
+		size_t y = referenceTiledY(static_cast<int>(b), widthInBlocks, texel_byte_pitch);
+		size_t src = (y * widthInBlocks + x) * T;
+		if (src + T <= input_size) {
+			std::memcpy(&gathered[b * T], &input[src], T);
+		}
+	}
+
+	size_t size = std::min(gathered.size(), output_size / T * T);
+	referenceShuffle(gathered, size, byte_order);
+	std::copy(gathered.begin(), gathered.begin() + size, output);
+}
+
+// Function to get the linear block index of Morton block <t>, one bit at a time
+inline size_t referenceMortonIndex(size_t t, size_t width, size_t height) {
+	size_t num1 = 1, num2 = 1, num3 = t;
+	size_t t_width = width, t_height = height;
+	size_t num6 = 0, num7 = 0;
+
+	while (t_width > 1 || t_height > 1) {
+		if (t_width > 1) {
+			num6 += num2 * (num3 & 1);
+			num3 >>= 1;
+			num2 *= 2;
+			t_width >>= 1;
+		}
+		if (t_height > 1) {
+			num7 += num1 * (num3 & 1);
+			num3 >>= 1;
+			num1 *= 2;
+			t_height >>= 1;
+		}
+	}
+
+	return num7 * width + num6;
+}
+
+inline void reference_unswizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height) {
+	size_t B = static_cast<size_t>(bytes_per_pixel) * block_width_height * block_width_height;
+	size_t blocks_w = width / block_width_height;
+	size_t blocks_h = height / block_width_height;
+	size_t source_blocks = std::min(blocks_w * blocks_h, input_size / B);
+
+	for (size_t t = 0; t < source_blocks; ++t) {
+		size_t dst = referenceMortonIndex(t, blocks_w, blocks_h) * B;
+		if (dst + B <= output_size) {
+			std::memcpy(&output[dst], &input[t * B], B);
+		}
+	}
+}
+
+inline void reference_swizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height) {
+	size_t B = static_cast<size_t>(bytes_per_pixel) * block_width_height * block_width_height;
+	size_t blocks_w = width / block_width_height;
+	size_t blocks_h = height / block_width_height;
+	size_t destination_blocks = std::min(blocks_w * blocks_h, output_size / B);
+
+	for (size_t t = 0; t < destination_blocks; ++t) {
+		size_t src = referenceMortonIndex(t, blocks_w, blocks_h) * B;
+		if (src + B <= input_size) {
+			std::memcpy(&output[t * B], &input[src], B);
+		}
+	}
+}
+
+// Function to get the block-linear address of byte <xb> of row <y>
+inline size_t referenceSwitchAddress(size_t xb, size_t y, size_t gobsPerRow, int block_height) {
+	size_t gobRows = 8 * static_cast<size_t>(block_height);
+	return (y / gobRows) * 512 * block_height * gobsPerRow
+		+ (xb / 64) * 512 * block_height
+		+ ((y % gobRows) / 8) * 512
+		+ ((xb % 64) / 32) * 256
+		+ ((y % 8) / 2) * 64
+		+ ((xb % 32) / 16) * 32
+		+ (y % 2) * 16
+		+ (xb % 16);
+}
+
+inline void reference_unswizzle_switch(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int img_width, int img_height, int bytes_per_block, int block_height) {
+	const size_t rowBytes = static_cast<size_t>(img_width) * bytes_per_block;
+	const size_t paddedRowBytes = (rowBytes + 63) / 64 * 64;
+
+	for (size_t y = 0; y < static_cast<size_t>(img_height); ++y) {
+		for (size_t xb = 0; xb < rowBytes; xb += bytes_per_block) {
+			size_t src = referenceSwitchAddress(xb, y, paddedRowBytes / 64, block_height);
+			size_t dst = y * rowBytes + xb;
+			// A truncated input holds no more than its size in padded linear data
+			if (src + bytes_per_block <= input_size && y * paddedRowBytes + xb + bytes_per_block <= input_size && dst + bytes_per_block <= output_size) {
+				std::memcpy(&output[dst], &input[src], bytes_per_block);
+			}
+		}
+	}
+}
+
+inline void reference_swizzle_switch(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int img_width, int img_height, int bytes_per_block, int block_height) {
+	const size_t rowBytes = static_cast<size_t>(img_width) * bytes_per_block;
+	const size_t paddedRowBytes = (rowBytes + 63) / 64 * 64;
+	const size_t gobRows = 8 * static_cast<size_t>(block_height);
+	const size_t paddedHeight = (static_cast<size_t>(img_height) + gobRows - 1) / gobRows * gobRows;
+
+	for (size_t y = 0; y < paddedHeight; ++y) {
+		// Bytes of this row present in the input, in whole blocks
+		size_t srcRow = y * rowBytes;
+		size_t visible = 0;
+		if (y < static_cast<size_t>(img_height) && srcRow < input_size) {
+			visible = std::min(rowBytes, (input_size - srcRow) / bytes_per_block * bytes_per_block);
+		}
+		for (size_t xb = 0; xb < paddedRowBytes; ++xb) {
+			size_t dst = referenceSwitchAddress(xb, y, paddedRowBytes / 64, block_height);
+			if (dst < output_size) {
+				output[dst] = xb < visible ? input[srcRow + xb] : 0;
+			}
+		}
+	}
+}
+
+// Kernel configuration checked by --verify
+struct VerifyCase {
+	std::string type;			// "x360", "morton" or "switch"
+	int width = 0;				// Pixels
+	int height = 0;
+	int blockPixelSize = 1;		// Xbox 360: pixels per block side; Morton: block width and height
+	int bytesPerBlock = 4;		// Xbox 360: texel byte pitch
+	int blockHeight = 1;		// Nintendo Switch: GOBs per block
+	const uint8_t* swizzleOrder = X360_SWAP16;
+	const uint8_t* unswizzleOrder = X360_SWAP16;
+
+	std::string describe() const {
+		std::stringstream description;
+		description << type << " " << width << "x" << height << " block " << blockPixelSize << " bytes " << bytesPerBlock;
+		if (type == "switch") description << " gobs " << blockHeight;
+		if (swizzleOrder != X360_SWAP16) description << " rgba";
+		return description.str();
+	}
+
+	// Sizes of the linear and swizzled surfaces
+	size_t linearSize() const {
+		size_t blocks = static_cast<size_t>(width / blockPixelSize) * (height / blockPixelSize);
+		return type == "morton" ? blocks * bytesPerBlock * blockPixelSize * blockPixelSize : blocks * bytesPerBlock;
+	}
+	size_t tiledSize() const {
+		if (type != "switch") {
+			return linearSize();
+		}
+		size_t gobRows = 8 * static_cast<size_t>(blockHeight);
+		return (static_cast<size_t>(width) * bytesPerBlock + 63) / 64 * 64 * ((height + gobRows - 1) / gobRows * gobRows);
+	}
+
+	// Whether swizzling then unswizzling gives back every linear byte
+	bool roundTrips() const {
+		auto powerOfTwo = [](int n) { return n > 0 && (n & (n - 1)) == 0; };
+		if (type == "x360") {
+			// 2-byte texels interleave two macro tiles in every 4 KB of tiled data
+			int macroSide = bytesPerBlock == 2 ? 64 : 32;
+			return (width / blockPixelSize) % macroSide == 0 && (height / blockPixelSize) % macroSide == 0;
+		} else if (type == "morton") {
+			return powerOfTwo(width / blockPixelSize) && powerOfTwo(height / blockPixelSize);
+		}
+		return true;
+	}
+
+	void unswizzle(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, unsigned int threads) const {
+		if (type == "x360") {
+			unswizzle_x360(input, input_size, output, output_size, width, height, blockPixelSize, bytesPerBlock, unswizzleOrder, threads);
+		} else if (type == "morton") {
+			unswizzle_morton(input, input_size, output, output_size, width, height, bytesPerBlock, blockPixelSize, threads);
+		} else {
+			unswizzle_switch(input, input_size, output, output_size, width, height, bytesPerBlock, blockHeight, threads);
+		}
+	}
+
+	void swizzle(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, unsigned int threads) const {
+		if (type == "x360") {
+			swizzle_x360(input, input_size, output, output_size, width, height, blockPixelSize, bytesPerBlock, swizzleOrder, threads);
+		} else if (type == "morton") {
+			swizzle_morton(input, input_size, output, output_size, width, height, bytesPerBlock, blockPixelSize, threads);
+		} else {
+			swizzle_switch(input, input_size, output, output_size, width, height, bytesPerBlock, blockHeight, threads);
+		}
+	}
+
+	void referenceUnswizzle(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) const {
+		if (type == "x360") {
+			reference_unswizzle_x360(input, input_size, output, output_size, width, height, blockPixelSize, bytesPerBlock, unswizzleOrder);
+		} else if (type == "morton") {
+			reference_unswizzle_morton(input, input_size, output, output_size, width, height, bytesPerBlock, blockPixelSize);
+		} else {
+			reference_unswizzle_switch(input, input_size, output, output_size, width, height, bytesPerBlock, blockHeight);
+		}
+	}
+
+	void referenceSwizzle(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size) const {
+		if (type == "x360") {
+			reference_swizzle_x360(input, input_size, output, output_size, width, height, blockPixelSize, bytesPerBlock, swizzleOrder);
+		} else if (type == "morton") {
+			reference_swizzle_morton(input, input_size, output, output_size, width, height, bytesPerBlock, blockPixelSize);
+		} else {
+			reference_swizzle_switch(input, input_size, output, output_size, width, height, bytesPerBlock, blockHeight);
+		}
+	}
+};
+
+// Function to report the first byte where two outputs differ
+inline bool sameOutput(const std::vector<uint8_t>& output, const std::vector<uint8_t>& expected, const std::string& check, const VerifyCase& verifyCase) {
+	if (output == expected) {
+		return true;
+	}
+	size_t i = std::mismatch(output.begin(), output.end(), expected.begin()).first - output.begin();
+	std::cerr << "* ERROR: " << check << " differs at byte " << i << ": " << verifyCase.describe() << std::endl;
+	return false;
+}
+
+// Payloads of one kernel check: a whole tiled and linear surface, the part of each handed to the kernels
+// as input, and the size of the outputs they fill (smaller than a whole surface to check truncation)
+struct VerifyPayload {
+	std::vector<uint8_t> tiled;			// verifyCase.tiledSize() bytes
+	std::vector<uint8_t> linear;		// verifyCase.linearSize() bytes
+	size_t tiledInputSize = 0;			// Unswizzle input
+	size_t linearOutputSize = 0;		// Unswizzle output
+	size_t linearInputSize = 0;			// Swizzle input
+	size_t tiledOutputSize = 0;			// Swizzle output
+};
+
+// Function to check the kernels of one configuration against the reference kernels, with a full or truncated
+// input and output, and against their own round trip where swizzling is lossless
+// The outputs start out holding the other surface of the payload, so that bytes a kernel must leave alone are checked too.
+inline bool verifyKernels(const VerifyCase& verifyCase, const VerifyPayload& payload, unsigned int threads) {
+	bool ok = true;
+	const std::vector<uint8_t>& tiled = payload.tiled;
+	const std::vector<uint8_t>& linear = payload.linear;
+
+	// Unswizzle
+	std::vector<uint8_t> expected(linear.begin(), linear.begin() + payload.linearOutputSize);
+	std::vector<uint8_t> output = expected;
+	verifyCase.referenceUnswizzle(tiled.data(), payload.tiledInputSize, expected.data(), expected.size());
+	verifyCase.unswizzle(tiled.data(), payload.tiledInputSize, output.data(), output.size(), threads);
+	ok &= sameOutput(output, expected, "unswizzle_" + verifyCase.type, verifyCase);
+
+	// Swizzle
+	expected.assign(tiled.begin(), tiled.begin() + payload.tiledOutputSize);
+	output = expected;
+	verifyCase.referenceSwizzle(linear.data(), payload.linearInputSize, expected.data(), expected.size());
+	verifyCase.swizzle(linear.data(), payload.linearInputSize, output.data(), output.size(), threads);
+	ok &= sameOutput(output, expected, "swizzle_" + verifyCase.type, verifyCase);
+
+	// Round trip
+	if (verifyCase.roundTrips()) {
+		std::vector<uint8_t> swizzled(tiled.size());
+		std::vector<uint8_t> unswizzled(linear.size());
+		verifyCase.swizzle(linear.data(), linear.size(), swizzled.data(), swizzled.size(), threads);
+		verifyCase.unswizzle(swizzled.data(), swizzled.size(), unswizzled.data(), unswizzled.size(), threads);
+		ok &= sameOutput(unswizzled, linear, "round trip " + verifyCase.type, verifyCase);
+	}
+
+	return ok;
+}
+
+} // namespace gbtex
+
+#endif // GBTEX_VERIFY_H
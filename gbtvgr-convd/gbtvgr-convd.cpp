@@ -0,0 +1,453 @@
+/*  Ghostbusters The Video Game Conversion Daemon
+	Copyright 2025 KeyofBlueS
+
+	The Ghostbusters The Video Game Conversion Daemon is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+#include <iostream>
+#include <string>
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <getopt.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#include <csignal>
+#include <cerrno>
+#include <thread>
+#include <new>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../libgbtex/gbtex.h"
+
+using namespace gbtex;
+
+bool quiet = false;	// Quiet mode flag
+BufferPool buffers;	// Input and output files of finished requests, reused by the next ones
+volatile sig_atomic_t stopRequested = 0;
+
+constexpr size_t MAX_REQUEST_LINE = 64 * 1024;	// Longest request line accepted
+size_t maxInlineSize = size_t(1024) << 20;		// Largest inline input accepted, set with --max-inline
+
+// Function to remove the socket left behind by a server that is no longer running
+// Anything else at <socketPath> (a regular file, a directory, a live server's socket) is left alone.
+bool removeStaleSocket(const std::string& socketPath, const sockaddr_un& address) {
+	struct stat status;
+	if (lstat(socketPath.c_str(), &status) < 0) {
+		return true;
+	}
+	if (!S_ISSOCK(status.st_mode)) {
+		std::cerr << "* ERROR: Socket path exists and is not a socket: " << socketPath << std::endl;
+		return false;
+	}
+
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0) {
+		std::cerr << "* ERROR: Unable to create socket: " << std::strerror(errno) << std::endl;
+		return false;
+	}
+	bool live = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+	close(probe);
+	if (live) {
+		std::cerr << "* ERROR: Another server is already listening on: " << socketPath << std::endl;
+		return false;
+	}
+
+	unlink(socketPath.c_str());
+	return true;
+}
+
+// Function to stop the server on SIGINT / SIGTERM
+void handleStopSignal(int) {
+	stopRequested = 1;
+}
+
+// Buffered reader over a connected socket
+class SocketReader {
+public:
+	explicit SocketReader(int fd) : fd(fd) {}
+
+	// Function to read a line without its terminating newline
+	bool readLine(std::string& line) {
+		line.clear();
+		while (true) {
+			if (start == end && !fill()) {
+				return false;
+			}
+			const char* newline = static_cast<const char*>(std::memchr(buffer + start, '\n', end - start));
+			size_t count = newline ? static_cast<size_t>(newline - (buffer + start)) : end - start;
+			line.append(buffer + start, count);
+			start += count;
+			if (newline) {
+				++start;
+				return true;
+			}
+			if (line.size() > MAX_REQUEST_LINE) {
+				return false;
+			}
+		}
+	}
+
+	// Function to read exactly <size> bytes
+	bool readBytes(uint8_t* destination, size_t size) {
+		while (size > 0) {
+			if (start == end && !fill()) {
+				return false;
+			}
+			size_t count = std::min(size, end - start);
+			std::memcpy(destination, buffer + start, count);
+			destination += count;
+			size -= count;
+			start += count;
+		}
+		return true;
+	}
+
+private:
+	bool fill() {
+		ssize_t count;
+		do {
+			count = read(fd, buffer, sizeof(buffer));
+		} while (count < 0 && errno == EINTR);
+		if (count <= 0) {
+			return false;
+		}
+		start = 0;
+		end = static_cast<size_t>(count);
+		return true;
+	}
+
+	int fd;
+	char buffer[64 * 1024];
+	size_t start = 0;
+	size_t end = 0;
+};
+
+// Function to write a whole buffer to a socket
+bool writeAll(int fd, const void* data, size_t size) {
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0) {
+		ssize_t count = write(fd, bytes, size);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return false;
+		}
+		bytes += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+
+// Function to send a response: "<code> <size>\n" followed by <size> bytes
+// On success the bytes are the converted file (none if it was written to disk), otherwise the error message.
+bool sendResponse(int fd, int code, const void* data, size_t size) {
+	std::string status = std::to_string(code) + " " + std::to_string(size) + "\n";
+	return writeAll(fd, status.data(), status.size()) && writeAll(fd, data, size);
+}
+
+// Function to split a request line into its direction and key=value fields
+// Fields are separated by tabs, so paths may contain spaces.
+bool parseRequest(const std::string& line, std::string& direction, std::map<std::string, std::string>& fields) {
+	size_t position = 0;
+	bool first = true;
+	while (position <= line.size()) {
+		size_t tab = line.find('\t', position);
+		if (tab == std::string::npos) {
+			tab = line.size();
+		}
+		std::string field = line.substr(position, tab - position);
+		position = tab + 1;
+
+		if (first) {
+			direction = field;
+			first = false;
+		} else if (!field.empty()) {
+			size_t equals = field.find('=');
+			if (equals == std::string::npos) {
+				return false;
+			}
+			fields[field.substr(0, equals)] = field.substr(equals + 1);
+		}
+	}
+	return !direction.empty();
+}
+
+// Function to run one conversion with the library routines
+int convertRequest(const std::string& direction, const std::map<std::string, std::string>& fields, ByteSpan input, std::vector<uint8_t>& output, std::string& error) {
+	if (direction == "tex2dds") {
+		return convertTexToDds(input, output, TexToDdsOptions(), error);
+	} else if (direction == "dds2tex") {
+		DdsToTexOptions options;
+		auto field = fields.find("platform");
+		if (field != fields.end()) {
+			options.platform = field->second;
+			std::transform(options.platform.begin(), options.platform.end(), options.platform.begin(),
+							[](unsigned char c) { return std::tolower(c); });
+		}
+		if (options.platform != "pc" && options.platform != "ps3" && options.platform != "xbox360" && options.platform != "switch") {
+			error = "Unsupported platform: '" + options.platform + "'. Supported platforms are 'pc', 'ps3', 'xbox360' or 'switch'.";
+			return 1;
+		}
+		options.forceDxt1 = fields.count("dxt1") && fields.at("dxt1") == "1";
+		options.forceDxt5 = fields.count("dxt5") && fields.at("dxt5") == "1";
+		return convertDdsToTex(input, output, options, error);
+	} else if (direction == "smp2ogg") {
+		return convertSmpToOgg(input, output, error);
+	} else if (direction == "ogg2smp") {
+		return convertOggToSmp(input, output, error);
+	}
+
+	error = "Unsupported conversion: '" + direction + "'. Supported conversions are 'tex2dds', 'dds2tex', 'smp2ogg' or 'ogg2smp'.";
+	return 1;
+}
+
+// Buffers of one request, handed back to the pool however the request ends
+struct RequestBuffers {
+	std::vector<uint8_t> inlineInput = buffers.acquire();
+	std::vector<uint8_t> output = buffers.acquire();
+
+	~RequestBuffers() {
+		buffers.release(inlineInput);
+		buffers.release(output);
+	}
+};
+
+// Function to serve every request of a client until it disconnects
+void serveConnection(int fd) {
+	SocketReader reader(fd);
+	std::string line;
+
+	while (reader.readLine(line)) {
+		std::string direction;
+		std::map<std::string, std::string> fields;
+		std::string error;
+		int code = 0;
+
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty()) {
+			continue;
+		}
+
+		if (!parseRequest(line, direction, fields)) {
+			error = "Malformed request.";
+			sendResponse(fd, 1, error.data(), error.size());
+			break;
+		}
+
+		RequestBuffers requestBuffers;
+		std::vector<uint8_t>& inlineInput = requestBuffers.inlineInput;
+		std::vector<uint8_t>& output = requestBuffers.output;
+
+		// Inline input follows the request line; a reused buffer is only cleared where it grows
+		// Once a request can't take its inline input, the rest of the stream can't be told apart from it:
+		// the error is sent and the connection closed.
+		if (fields.count("size")) {
+			const std::string& size = fields.at("size");
+			if (size.empty() || size.size() > 19 || size.find_first_not_of("0123456789") != std::string::npos) {
+				error = "Invalid inline input size: " + size;
+			} else if (std::stoull(size) > maxInlineSize) {
+				error = "Inline input of " + size + " bytes is larger than the limit of " + std::to_string(maxInlineSize) + " bytes.";
+			} else {
+				try {
+					inlineInput.resize(std::stoull(size));
+				} catch (const std::exception&) {
+					error = "Out of memory.";
+				}
+			}
+			if (!error.empty()) {
+				sendResponse(fd, 1, error.data(), error.size());
+				break;
+			}
+			if (!reader.readBytes(inlineInput.data(), inlineInput.size())) {
+				break;
+			}
+		}
+
+		try {
+			if (fields.count("input")) {
+				MappedFile inputFile(fields.at("input"));
+				if (!inputFile.is_open()) {
+					error = "Unable to open file: " + fields.at("input");
+					code = 3;
+				} else {
+					code = convertRequest(direction, fields, inputFile.span(), output, error);
+				}
+			} else if (fields.count("size")) {
+				code = convertRequest(direction, fields, ByteSpan{inlineInput.data(), inlineInput.size()}, output, error);
+			} else {
+				error = "No input specified.";
+				code = 1;
+			}
+
+			// Write the output file, or send the output back
+			if (code == 0 && fields.count("output")) {
+				const std::string& outputFile = fields.at("output");
+				createDirectories(std::filesystem::path(outputFile).parent_path().string());
+				if (!writeFile(outputFile, output)) {
+					error = "Unable to open output file: " + outputFile;
+					code = 1;
+				}
+				output.clear();
+			}
+		} catch (const std::bad_alloc&) {
+			error = "Out of memory.";
+			code = 1;
+		} catch (const std::exception& e) {
+			error = e.what();
+			code = 1;
+		}
+
+		bool sent = code == 0
+			? sendResponse(fd, code, output.data(), output.size())
+			: sendResponse(fd, code, error.data(), error.size());
+		if (!sent) {
+			break;
+		}
+	}
+
+	close(fd);
+}
+
+// Function to print the help message
+void printHelpMessage() {
+	std::cout << std::endl;
+	std::cout << "👻 GBTVGR Conversion Daemon v0.1.0" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Usage: gbtvgr-convd [options]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -s, --socket <socket_path>		Listen on the <socket_path> Unix domain socket. Default is '/tmp/gbtvgr-convd.sock'." << std::endl;
+	std::cout << "  -M, --max-inline <MB>			Reject inline inputs larger than <MB> megabytes. Default is 1024." << std::endl;
+	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
+	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
+	std::cout << std::endl;
+	std::cout << std::endl;
+	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
+	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
+	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
+	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+
+	std::string socketPath = "/tmp/gbtvgr-convd.sock";
+	bool argError = false;
+
+	// Define the long options for getopt
+	struct option long_options[] = {
+		{"socket", required_argument, nullptr, 's'},
+		{"max-inline", required_argument, nullptr, 'M'},
+		{"quiet", no_argument, nullptr, 'q'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0}	// Terminate the list of options
+	};
+
+	// Parse command-line arguments
+	int opt;
+	int option_index = 0;
+	while ((opt = getopt_long(argc, argv, "s:M:qh", long_options, &option_index)) != -1) {
+		switch (opt) {
+			case 's':
+				socketPath = optarg;
+				break;
+			case 'M':
+				try {
+					size_t megabytes = std::stoull(optarg);
+					if (megabytes == 0 || megabytes > (SIZE_MAX >> 20)) {
+						throw std::out_of_range(optarg);
+					}
+					maxInlineSize = megabytes << 20;
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid inline input limit: " << optarg << std::endl;
+				}
+				break;
+			case 'q':
+				quiet = true;
+				break;
+			case 'h':
+				printHelpMessage();
+				return 0;
+			case '?':
+			default:
+				argError = true;
+		}
+	}
+
+	for (int i = optind; i < argc; ++i) {
+		argError = true;
+		std::cerr << "* ERROR: Unexpected argument: " << argv[i] << std::endl;
+	}
+
+	sockaddr_un address = {};
+	if (socketPath.size() >= sizeof(address.sun_path)) {
+		argError = true;
+		std::cerr << "* ERROR: Socket path is too long: " << socketPath << std::endl;
+	}
+
+	if (argError) {
+		printHelpMessage();
+		return 1;
+	}
+
+	// Create the listening socket, replacing a stale one
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0) {
+		std::cerr << "* ERROR: Unable to create socket: " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	if (!removeStaleSocket(socketPath, address)) {
+		close(server);
+		return 1;
+	}
+	if (bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(server, SOMAXCONN) < 0) {
+		std::cerr << "* ERROR: Unable to listen on socket: " << socketPath << ": " << std::strerror(errno) << std::endl;
+		close(server);
+		return 1;
+	}
+
+	// Clients hanging up must not kill the server, and a stop signal must interrupt accept()
+	std::signal(SIGPIPE, SIG_IGN);
+	struct sigaction stopAction = {};
+	stopAction.sa_handler = handleStopSignal;
+	sigaction(SIGINT, &stopAction, nullptr);
+	sigaction(SIGTERM, &stopAction, nullptr);
+
+	if (!quiet) std::cout << "Listening on: " << socketPath << std::endl;
+
+	// Serve every client on its own thread
+	while (!stopRequested) {
+		int client = accept(server, nullptr, nullptr);
+		if (client < 0) {
+			if (errno != EINTR) {
+				std::cerr << "* ERROR: Unable to accept connection: " << std::strerror(errno) << std::endl;
+			}
+			continue;
+		}
+		std::thread(serveConnection, client).detach();
+	}
+
+	close(server);
+	unlink(socketPath.c_str());
+
+	if (!quiet) std::cout << "Server stopped." << std::endl;
+	return 0;
+}
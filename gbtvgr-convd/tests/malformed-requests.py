@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#  Ghostbusters The Video Game Conversion Daemon - malformed request test
+#  Copyright 2025 KeyofBlueS
+#
+#  Starts gbtvgr-convd, sends it TEX files whose headers plan more than they hold, and checks that
+#  each one is rejected as an invalid file while the server keeps answering, on the same connection
+#  and on a new one. Inline sizes the server can't take must get an error and close the connection.
+#
+#  Usage: malformed-requests.py <path/to/gbtvgr-convd>
+
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def tex_file(tex_format, width, height, mip_count, payload_size):
+	header = struct.pack("<I16sIIIIIIII", 7, bytes(16), 0, tex_format, width, height, 0, mip_count, 0, 0)
+	return header + bytes([0x11]) * payload_size
+
+
+def request(connection, reader, direction, data):
+	connection.sendall(b"%s\tsize=%d\n" % (direction, len(data)) + data)
+	code, size = reader.readline().split()
+	return int(code), reader.read(int(size))
+
+
+def connect(socket_path):
+	connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+	connection.settimeout(30)
+	connection.connect(socket_path)
+	return connection, connection.makefile("rb")
+
+
+def main():
+	if len(sys.argv) != 2:
+		print("Usage: malformed-requests.py <path/to/gbtvgr-convd>", file=sys.stderr)
+		return 1
+
+	directory = tempfile.mkdtemp()
+	socket_path = os.path.join(directory, "convd.sock")
+	server = subprocess.Popen([sys.argv[1], "--socket", socket_path, "--quiet"])
+	try:
+		for _ in range(100):
+			if os.path.exists(socket_path):
+				break
+			time.sleep(0.05)
+
+		malformed = {
+			"mip count 0xFFFFFFFF": tex_file(0x16, 4, 4, 0xFFFFFFFF, 64),
+			"mip count 0x7FFFFFFE": tex_file(0x27, 4, 4, 0x7FFFFFFE, 64),
+			"60000x60000 in 64 bytes": tex_file(0x41, 60000, 60000, 0, 64),
+		}
+		valid = tex_file(0x16, 32, 32, 0, 32 * 32 * 4)
+
+		failures = 0
+		connection, reader = connect(socket_path)
+		for name, data in malformed.items():
+			code, message = request(connection, reader, b"tex2dds", data)
+			if code != 3:
+				print("* FAILED: %s: expected code 3, got %d (%s)" % (name, code, message.decode(errors="replace")))
+				failures += 1
+			code, message = request(connection, reader, b"tex2dds", valid)
+			if code != 0:
+				print("* FAILED: valid request after %s: code %d" % (name, code))
+				failures += 1
+		connection.close()
+
+		# An inline size the server can't take must close the connection rather than read the payload as requests
+		for size in (b"99999999999999999", b"18446744073709551616", b"12x"):
+			connection, reader = connect(socket_path)
+			connection.sendall(b"smp2ogg\tsize=%s\n" % size + b"smp2ogg\tsize=4\nOggS" * 4)
+			response = reader.readline().split()
+			if len(response) != 2 or response[0] != b"1":
+				print("* FAILED: inline size %s: expected code 1, got %s" % (size.decode(), response))
+				failures += 1
+			else:
+				reader.read(int(response[1]))
+				if reader.read(1) != b"":
+					print("* FAILED: inline size %s: connection left open" % size.decode())
+					failures += 1
+			connection.close()
+
+		# The server must still accept new clients
+		connection, reader = connect(socket_path)
+		code, message = request(connection, reader, b"tex2dds", valid)
+		connection.close()
+		if code != 0 or server.poll() is not None:
+			print("* FAILED: server stopped answering")
+			failures += 1
+
+		print("%s: %d failure(s)" % ("FAILED" if failures else "OK", failures))
+		return 1 if failures else 0
+	except (OSError, ValueError) as e:
+		print("* FAILED: %s (server exit code: %s)" % (e, server.poll()))
+		return 1
+	finally:
+		server.terminate()
+		server.wait()
+		if os.path.exists(socket_path):
+			os.unlink(socket_path)
+		os.rmdir(directory)
+
+
+if __name__ == "__main__":
+	sys.exit(main())
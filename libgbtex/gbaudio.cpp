@@ -0,0 +1,122 @@
+/*  Ghostbusters The Video Game Audio Conversions
+	Copyright 2025 KeyofBlueS - https://github.com/KeyofBlueS
+
+	The Ghostbusters The Video Game Audio Conversions are free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+#include "gbtex.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace gbtex {
+
+// Function to check an Ogg page starting at <offset>: it must fit in <input> and match its CRC
+// The CRC is the direct (unreflected) CRC-32 with polynomial 0x04c11db7, computed with the CRC field set to 0.
+bool isOggPage(ByteSpan input, size_t offset) {
+	const size_t pageHeaderSize = 27;
+	if (input.size - offset < pageHeaderSize || std::memcmp(input.data + offset, "OggS", 4) != 0 || input.data[offset + 4] != 0) {
+		return false;
+	}
+	size_t segments = input.data[offset + 26];
+	if (input.size - offset < pageHeaderSize + segments) {
+		return false;
+	}
+	size_t pageSize = pageHeaderSize + segments;
+	for (size_t i = 0; i < segments; ++i) {
+		pageSize += input.data[offset + pageHeaderSize + i];
+	}
+	if (input.size - offset < pageSize) {
+		return false;
+	}
+
+	uint32_t crc = 0;
+	for (size_t i = 0; i < pageSize; ++i) {
+		uint8_t byte = (i >= 22 && i < 26) ? 0 : input.data[offset + i];
+		crc ^= static_cast<uint32_t>(byte) << 24;
+		for (int bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+		}
+	}
+	uint32_t storedCrc;
+	std::memcpy(&storedCrc, input.data + offset + 22, sizeof(storedCrc));
+	return crc == storedCrc;
+}
+
+// Function to get the duration of an OGG Vorbis file held in memory in milliseconds, -1 if it can't be read
+// Instead of opening the stream with libvorbisfile, the sample rate is taken from the Vorbis identification
+// header on the first page and the sample count from the granule position of the last page of the stream.
+long long getOggDurationMilliseconds(ByteSpan input) {
+	const size_t pageHeaderSize = 27;	// Up to the segment table
+
+	uint32_t sampleRate = getOggSampleRate(input);
+	if (sampleRate == 0) {
+		return -1;
+	}
+	uint32_t serial;
+	std::memcpy(&serial, input.data + 14, sizeof(serial));
+
+	// Last page of the stream with a granule position (-1 on pages where no packet ends)
+	for (size_t offset = input.size - pageHeaderSize + 1; offset-- > 0; ) {
+		if (input.data[offset] != 'O' || !isOggPage(input, offset)) {
+			continue;
+		}
+		int64_t granule;
+		uint32_t pageSerial;
+		std::memcpy(&granule, input.data + offset + 6, sizeof(granule));
+		std::memcpy(&pageSerial, input.data + offset + 14, sizeof(pageSerial));
+		if (pageSerial == serial && granule >= 0) {
+			return granule * 1000 / sampleRate;
+		}
+	}
+	return -1;
+}
+
+// Function to fill the SMP header of an OGG file of <oggSize> bytes and <durationMilliseconds>
+// The other fields keep the values the original ogg2smp wrote for every file, 44100 at byte 48 included.
+SMP_Header makeSmpHeader(size_t oggSize, long long durationMilliseconds) {
+	SMP_Header smpHeader;
+
+	// Duration is stored with 275 ms added, in 1/44 ms units
+	smpHeader.dwDuration = static_cast<DWORD>((durationMilliseconds + 275) * 44);
+	smpHeader.dwOggSize = static_cast<DWORD>(oggSize);
+	return smpHeader;
+}
+
+// Function to convert an SMP file held in memory to OGG
+int convertSmpToOgg(ByteSpan input, std::vector<uint8_t>& output, std::string& error) {
+
+	// Check if the file holds a valid OGG stream after its header
+	if (input.size < SMP_HEADER_SIZE + 3 || std::memcmp(input.data + SMP_HEADER_SIZE, "Ogg", 3) != 0) {
+		error = "Not a valid SMP file!";
+		return 3;
+	}
+
+	output.assign(input.data + SMP_HEADER_SIZE, input.data + input.size);
+	return 0;
+}
+
+// Function to convert an OGG file held in memory to SMP
+int convertOggToSmp(ByteSpan input, std::vector<uint8_t>& output, std::string& error) {
+
+	// Check if the file has a valid OGG header
+	if (input.size < 3 || std::memcmp(input.data, "Ogg", 3) != 0) {
+		error = "Not a valid OGG file!";
+		return 3;
+	}
+
+	// Prepare the 160 bytes header
+	SMP_Header smpHeader = makeSmpHeader(input.size, getOggDurationMilliseconds(input));
+
+	// Append the input OGG file
+	output.resize(SMP_HEADER_SIZE + input.size);
+	std::memcpy(output.data(), &smpHeader, SMP_HEADER_SIZE);
+	std::memcpy(output.data() + SMP_HEADER_SIZE, input.data, input.size);
+	return 0;
+}
+
+}	// namespace gbtex
@@ -0,0 +1,2759 @@
+/*  Ghostbusters The Video Game Texture Library
+	Copyright 2010 Jonathan Wilson
+	Copyright barncastle
+	Copyright 2025 KeyofBlueS - https://github.com/KeyofBlueS
+
+	The Ghostbusters The Video Game Texture Library is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+#include "gbtex.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#else
+#include <io.h>
+#include <fcntl.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace gbtex {
+
+inline int xgAddress2DTiledX(int blockOffset, int widthInBlocks, int texelBytePitch) {
+	int alignedWidth = (widthInBlocks + 31) & ~31;
+	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+	int offsetByte = blockOffset << logBpp;
+	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
+	int offsetMacro = offsetTile >> (7 + logBpp);
+
+	int macroX = (offsetMacro % (alignedWidth >> 5)) << 2;
+	int tile = (((offsetTile >> (5 + logBpp)) & 2) + (offsetByte >> 6)) & 3;
+	int macro = (macroX + tile) << 3;
+	int micro = ((((offsetTile >> 1) & ~0xF) + (offsetTile & 0xF)) & ((texelBytePitch << 3) - 1)) >> logBpp;
+
+	return macro + micro;
+}
+
+inline int xgAddress2DTiledY(int blockOffset, int widthInBlocks, int texelBytePitch) {
+	int alignedWidth = (widthInBlocks + 31) & ~31;
+	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
+	int offsetByte = blockOffset << logBpp;
+	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
+	int offsetMacro = offsetTile >> (7 + logBpp);
+
+	int macroY = (offsetMacro / (alignedWidth >> 5)) << 2;
+	int tile = ((offsetTile >> (6 + logBpp)) & 1) + ((offsetByte & 0x800) >> 10);
+	int macro = (macroY + tile) << 3;
+	int micro = (((offsetTile & ((texelBytePitch << 6) - 1 & ~0x1F)) + ((offsetTile & 0xF) << 1)) >> (3 + logBpp)) & ~1;
+
+	return macro + micro + ((offsetTile & 0x10) >> 4);
+}
+
+// Byte shuffle kernels
+// shuffle_bytes() copies <size> bytes from <src> to <dst>, reordering every 16 bytes as given by
+// <byte_order>: output byte i is taken from input byte byte_order[i]. The order must not move bytes
+// across texels, and <size> must be a whole number of texels; <dst> may be the same as <src>.
+// The fastest kernel supported by the CPU is picked on first use.
+void shuffle_bytes_scalar(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order) {
+	uint8_t chunk[16];
+	for (size_t offset = 0; offset < size; offset += 16) {
+		size_t count = std::min<size_t>(16, size - offset);
+		std::memcpy(chunk, src + offset, count);
+		for (size_t i = 0; i < count; ++i) {
+			dst[offset + i] = chunk[byte_order[i]];
+		}
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3")))
+void shuffle_bytes_ssse3(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order) {
+	const __m128i order = _mm_loadu_si128(reinterpret_cast<const __m128i*>(byte_order));
+	size_t offset = 0;
+	for (; offset + 16 <= size; offset += 16) {
+		__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset), _mm_shuffle_epi8(data, order));
+	}
+	shuffle_bytes_scalar(dst + offset, src + offset, size - offset, byte_order);
+}
+
+__attribute__((target("avx2")))
+void shuffle_bytes_avx2(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order) {
+	const __m256i order = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(byte_order)));
+	size_t offset = 0;
+	for (; offset + 32 <= size; offset += 32) {
+		__m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + offset), _mm256_shuffle_epi8(data, order));
+	}
+	shuffle_bytes_ssse3(dst + offset, src + offset, size - offset, byte_order);
+}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+void shuffle_bytes_neon(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order) {
+	const uint8x16_t order = vld1q_u8(byte_order);
+	size_t offset = 0;
+	for (; offset + 16 <= size; offset += 16) {
+		vst1q_u8(dst + offset, vqtbl1q_u8(vld1q_u8(src + offset), order));
+	}
+	shuffle_bytes_scalar(dst + offset, src + offset, size - offset, byte_order);
+}
+#endif
+
+typedef void (*ShuffleBytesFunction)(uint8_t*, const uint8_t*, size_t, const uint8_t*);
+
+ShuffleBytesFunction select_shuffle_bytes() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return shuffle_bytes_avx2;
+	}
+	if (__builtin_cpu_supports("ssse3")) {
+		return shuffle_bytes_ssse3;
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	return shuffle_bytes_neon;
+#endif
+	return shuffle_bytes_scalar;
+}
+
+void shuffle_bytes(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order) {
+	static const ShuffleBytesFunction shuffle = select_shuffle_bytes();
+	shuffle(dst, src, size, byte_order);
+}
+
+// Function to build the byte order reversing every texel of <texel_bytes> bytes (a divisor of 16)
+void build_reverse_order(uint8_t byte_order[16], int texel_bytes) {
+	for (int i = 0; i < 16; ++i) {
+		byte_order[i] = static_cast<uint8_t>((i / texel_bytes) * texel_bytes + (texel_bytes - 1 - i % texel_bytes));
+	}
+}
+
+// Smallest share of a surface worth handing to another thread
+constexpr size_t MIN_BAND_BYTES = 1 << 20;
+
+// Function to run <band> over [0, count), split into bands of at least <grain> items spread across
+// <threads> threads (0: one per CPU core). Kernels only write disjoint parts of their output from
+// different bands, so the result doesn't depend on the number of threads.
+void runBands(size_t count, size_t grain, unsigned int threads, const std::function<void(size_t, size_t)>& band) {
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	grain = std::max<size_t>(grain, 1);
+	size_t bands = std::min<size_t>(count / grain, static_cast<size_t>(threads) * 4);
+	if (threads == 1 || bands <= 1) {
+		band(0, count);
+		return;
+	}
+	threads = static_cast<unsigned int>(std::min<size_t>(threads, bands));
+
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t b = next++; b < bands; b = next++) {
+			band(count * b / bands, count * (b + 1) / bands);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threads; ++t) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+}
+
+// Xbox 360 tiled surfaces are made of micro-tile rows of 16 bytes, each one holding consecutive
+// blocks of a single linear row. A macro tile (32x32 blocks) fills 1024 blocks of tiled data, except
+// for 2-byte texels where two macro tiles are interleaved every 4 KB. Where a micro-tile row lands
+// inside its macro tile only depends on its position in that period, so it is computed once per
+// surface, leaving only the macro tile origin to be computed once per period.
+struct X360TileRow {
+	int macro;	// Macro tile relative to the first one of the period
+	int x;		// Position in blocks inside the macro tile
+	int y;
+};
+
+std::vector<X360TileRow> build_x360_tile_rows(int texel_byte_pitch, size_t periodBytes) {
+	int logBpp = (texel_byte_pitch >> 2) + ((texel_byte_pitch >> 1) >> (texel_byte_pitch >> 2));
+	std::vector<X360TileRow> tileRows(periodBytes / 16);
+
+	for (size_t r = 0; r < tileRows.size(); ++r) {
+		int offsetByte = static_cast<int>(r << 4);
+		int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
+		tileRows[r].macro = offsetTile >> (7 + logBpp);
+
+		// With two macro tiles per row, the first period only spans macro tiles 0 and 1 side by side
+		tileRows[r].x = xgAddress2DTiledX(offsetByte >> logBpp, 64, texel_byte_pitch) - tileRows[r].macro * 32;
+		tileRows[r].y = xgAddress2DTiledY(offsetByte >> logBpp, 64, texel_byte_pitch);
+	}
+
+	return tileRows;
+}
+
+template <int TexelBytePitch>
+void unswizzle_x360_rows(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int widthInBlocks, int heightInBlocks, const uint8_t* byte_order, unsigned int threads) {
+	constexpr size_t blocksPerRow = 16 / TexelBytePitch;
+	constexpr size_t periodBytes = TexelBytePitch == 2 ? 4096 : 1024 * TexelBytePitch;
+	constexpr size_t blocksPerPeriod = periodBytes / TexelBytePitch;
+	constexpr size_t macroTilesPerPeriod = TexelBytePitch == 2 ? 2 : 1;
+
+	const std::vector<X360TileRow> tileRows = build_x360_tile_rows(TexelBytePitch, periodBytes);
+	const size_t macroTilesPerRow = ((widthInBlocks + 31) & ~31) >> 5;
+	const size_t rowPitch = static_cast<size_t>(widthInBlocks) * TexelBytePitch;
+	const size_t totalBlocks = static_cast<size_t>(widthInBlocks) * heightInBlocks;
+	const size_t periods = (totalBlocks + blocksPerPeriod - 1) / blocksPerPeriod;
+
+	// Macro tiles sticking out of a surface whose width isn't a whole number of them spill into the
+	// next rows, where the last period written wins: such surfaces are unswizzled in order.
+	if (widthInBlocks % 32 != 0) {
+		threads = 1;
+	}
+
+	runBands(periods, MIN_BAND_BYTES / periodBytes, threads, [&](size_t firstPeriod, size_t endPeriod) {
+		alignas(32) uint8_t shuffled[periodBytes];
+
+		for (size_t period = firstPeriod; period < endPeriod; ++period) {
+			size_t periodStart = period * periodBytes;
+			if (periodStart >= input_size) {
+				break;
+			}
+
+			// Byte order the whole period at once, while it stays in cache for the scatter below
+			size_t periodSize = std::min(periodBytes, input_size - periodStart);
+			shuffle_bytes(shuffled, input + periodStart, periodSize - periodSize % TexelBytePitch, byte_order);
+
+			// Origins of the macro tiles filled by this period
+			size_t macroOrigin[macroTilesPerPeriod];
+			for (size_t m = 0; m < macroTilesPerPeriod; ++m) {
+				size_t macro = period * macroTilesPerPeriod + m;
+				macroOrigin[m] = (macro / macroTilesPerRow) * 32 * rowPitch + (macro % macroTilesPerRow) * 32 * TexelBytePitch;
+			}
+
+			for (size_t r = 0; r < tileRows.size(); ++r) {
+				size_t firstBlock = period * blocksPerPeriod + r * blocksPerRow;
+				if (firstBlock >= totalBlocks) {
+					break;
+				}
+
+				const X360TileRow& tileRow = tileRows[r];
+				size_t src = firstBlock * TexelBytePitch;
+				size_t dst = macroOrigin[tileRow.macro] + tileRow.y * rowPitch + tileRow.x * TexelBytePitch;
+
+				if (firstBlock + blocksPerRow <= totalBlocks && dst + 16 <= output_size && src + 16 <= input_size) {
+					std::memcpy(&output[dst], &shuffled[r * 16], 16);
+					continue;
+				}
+
+				// Partial micro-tile row at the edge of the surface
+				for (size_t k = 0; k < blocksPerRow && firstBlock + k < totalBlocks; ++k) {
+					size_t srcByteOffset = src + k * TexelBytePitch;
+					size_t dstByteOffset = dst + k * TexelBytePitch;
+					if (dstByteOffset + TexelBytePitch <= output_size && srcByteOffset + TexelBytePitch <= input_size) {
+						std::memcpy(&output[dstByteOffset], &shuffled[r * 16 + k * TexelBytePitch], TexelBytePitch);
+					}
+				}
+			}
+		}
+	});
+}
+
+// The 16-bit word swap and the optional channel reorder are applied on the fly, one period
+// at a time, so the data is only read once.
+void unswizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order, unsigned int threads) {
+	const int widthInBlocks = width / block_pixel_size;
+	const int heightInBlocks = height / block_pixel_size;
+
+	if (input_size % 2 != 0)
+		throw std::runtime_error("Data size must be a multiple of 2 bytes!");
+
+	switch (texel_byte_pitch) {
+	case 2:
+		unswizzle_x360_rows<2>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 4:
+		unswizzle_x360_rows<4>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 8:
+		unswizzle_x360_rows<8>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 16:
+		unswizzle_x360_rows<16>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	default:
+		throw std::runtime_error("Unsupported texel byte pitch!");
+	}
+}
+
+template <int TexelBytePitch>
+void swizzle_x360_rows(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int widthInBlocks, int heightInBlocks, const uint8_t* byte_order, unsigned int threads) {
+	constexpr size_t blocksPerRow = 16 / TexelBytePitch;
+	constexpr size_t periodBytes = TexelBytePitch == 2 ? 4096 : 1024 * TexelBytePitch;
+	constexpr size_t blocksPerPeriod = periodBytes / TexelBytePitch;
+	constexpr size_t macroTilesPerPeriod = TexelBytePitch == 2 ? 2 : 1;
+
+	const std::vector<X360TileRow> tileRows = build_x360_tile_rows(TexelBytePitch, periodBytes);
+	const size_t macroTilesPerRow = ((widthInBlocks + 31) & ~31) >> 5;
+	const size_t rowPitch = static_cast<size_t>(widthInBlocks) * TexelBytePitch;
+	const size_t totalBlocks = static_cast<size_t>(widthInBlocks) * heightInBlocks;
+	const size_t periods = (totalBlocks + blocksPerPeriod - 1) / blocksPerPeriod;
+
+	runBands(periods, MIN_BAND_BYTES / periodBytes, threads, [&](size_t firstPeriod, size_t endPeriod) {
+		alignas(32) uint8_t gathered[periodBytes];
+
+		for (size_t period = firstPeriod; period < endPeriod; ++period) {
+			size_t periodStart = period * periodBytes;
+			if (periodStart >= output_size) {
+				break;
+			}
+
+			// Origins of the macro tiles filled by this period
+			size_t macroOrigin[macroTilesPerPeriod];
+			for (size_t m = 0; m < macroTilesPerPeriod; ++m) {
+				size_t macro = period * macroTilesPerPeriod + m;
+				macroOrigin[m] = (macro / macroTilesPerRow) * 32 * rowPitch + (macro % macroTilesPerRow) * 32 * TexelBytePitch;
+			}
+
+			// Gather the period from the linear surface; blocks outside of it are left blank
+			size_t periodBlocks = std::min(blocksPerPeriod, totalBlocks - period * blocksPerPeriod);
+			for (size_t r = 0; r * blocksPerRow < periodBlocks; ++r) {
+				const X360TileRow& tileRow = tileRows[r];
+				size_t dst = macroOrigin[tileRow.macro] + tileRow.y * rowPitch + tileRow.x * TexelBytePitch;
+
+				if ((r + 1) * blocksPerRow <= periodBlocks && dst + 16 <= input_size) {
+					std::memcpy(&gathered[r * 16], &input[dst], 16);
+					continue;
+				}
+
+				// Partial micro-tile row at the edge of the surface
+				for (size_t k = 0; k < blocksPerRow; ++k) {
+					size_t dstByteOffset = dst + k * TexelBytePitch;
+					if (r * blocksPerRow + k < periodBlocks && dstByteOffset + TexelBytePitch <= input_size) {
+						std::memcpy(&gathered[r * 16 + k * TexelBytePitch], &input[dstByteOffset], TexelBytePitch);
+					} else {
+						std::memset(&gathered[r * 16 + k * TexelBytePitch], 0, TexelBytePitch);
+					}
+				}
+			}
+
+			// Byte order the whole period at once, straight into the tiled surface
+			size_t periodSize = std::min(periodBlocks * TexelBytePitch, (output_size - periodStart) / TexelBytePitch * TexelBytePitch);
+			shuffle_bytes(&output[periodStart], gathered, periodSize, byte_order);
+		}
+	});
+}
+
+// The 16-bit word swap and the optional channel reorder are applied on the fly, one period
+// at a time, so the data is only read once.
+void swizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order, unsigned int threads) {
+	const int widthInBlocks = width / block_pixel_size;
+	const int heightInBlocks = height / block_pixel_size;
+
+	if (input_size % 2 != 0)
+		throw std::runtime_error("Data size must be a multiple of 2 bytes!");
+
+	switch (texel_byte_pitch) {
+	case 2:
+		swizzle_x360_rows<2>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 4:
+		swizzle_x360_rows<4>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 8:
+		swizzle_x360_rows<8>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	case 16:
+		swizzle_x360_rows<16>(input, input_size, output, output_size, widthInBlocks, heightInBlocks, byte_order, threads);
+		break;
+	default:
+		throw std::runtime_error("Unsupported texel byte pitch!");
+	}
+}
+
+// Per-axis Morton tables
+// The Morton index interleaves the x and y bits starting from x; once the shorter axis runs out
+// of bits the remaining ones belong to the longer axis. Spreading each axis once into a table
+// turns the index of any block into a single mortonX[x] | mortonY[y].
+struct MortonTables {
+	std::vector<size_t> x;
+	std::vector<size_t> y;
+	int bits = 0;	// Index bits taken by both axes together
+};
+
+MortonTables build_morton_tables(size_t width, size_t height) {
+	MortonTables morton;
+	std::vector<int> xBits;
+	std::vector<int> yBits;
+	size_t t_width = width, t_height = height;
+
+	while (t_width > 1 || t_height > 1) {
+		if (t_width > 1) {
+			xBits.push_back(morton.bits++);
+			t_width >>= 1;
+		}
+		if (t_height > 1) {
+			yBits.push_back(morton.bits++);
+			t_height >>= 1;
+		}
+	}
+
+	morton.x.assign(size_t(1) << xBits.size(), 0);
+	for (size_t x = 0; x < morton.x.size(); ++x) {
+		for (size_t b = 0; b < xBits.size(); ++b) {
+			morton.x[x] |= ((x >> b) & 1) << xBits[b];
+		}
+	}
+	morton.y.assign(size_t(1) << yBits.size(), 0);
+	for (size_t y = 0; y < morton.y.size(); ++y) {
+		for (size_t b = 0; b < yBits.size(); ++b) {
+			morton.y[y] |= ((y >> b) & 1) << yBits[b];
+		}
+	}
+
+	return morton;
+}
+
+// Copy every covered block of the linear surface, row by row, from its Morton position
+// When a side is not a power of two the index bits don't cover the whole surface: blocks
+// beyond the covered area stay untouched, and every covered block takes the last source block
+// sharing its index bits.
+template <size_t BlockBytes>
+void unswizzle_morton_rows(const uint8_t* input, uint8_t* output, size_t output_size, const MortonTables& morton, size_t blocks_w, size_t source_blocks, size_t block_size_bytes, size_t first_row, size_t end_row) {
+	const size_t blockBytes = BlockBytes ? BlockBytes : block_size_bytes;
+	const size_t columns = std::min(morton.x.size(), blocks_w);
+
+	for (size_t y = first_row; y < end_row; ++y) {
+		size_t rowOffset = y * blocks_w * blockBytes;
+		if (rowOffset >= output_size) {
+			break;
+		}
+		uint8_t* row = output + rowOffset;
+		size_t rowColumns = std::min(columns, (output_size - rowOffset) / blockBytes);
+		const size_t rowIndex = morton.y[y];
+
+		for (size_t x = 0; x < rowColumns; ++x) {
+			size_t t = morton.x[x] | rowIndex;
+			if (t >= source_blocks) {
+				continue;
+			}
+			t += ((source_blocks - 1 - t) >> morton.bits) << morton.bits;
+			std::memcpy(row + x * blockBytes, input + t * blockBytes, blockBytes);
+		}
+	}
+}
+
+void unswizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height, unsigned int threads) {
+	size_t block_size_bytes = static_cast<size_t>(bytes_per_pixel) * block_width_height * block_width_height;
+
+	size_t blocks_w = width / block_width_height;
+	size_t blocks_h = height / block_width_height;
+	size_t source_blocks = std::min(blocks_w * blocks_h, input_size / block_size_bytes);
+
+	MortonTables morton = build_morton_tables(blocks_w, blocks_h);
+
+	// Every band covers whole rows of the linear surface
+	const size_t rowBytes = std::max<size_t>(blocks_w * block_size_bytes, 1);
+	runBands(morton.y.size(), MIN_BAND_BYTES / rowBytes, threads, [&](size_t firstRow, size_t endRow) {
+		switch (block_size_bytes) {
+		case 1:
+			unswizzle_morton_rows<1>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 2:
+			unswizzle_morton_rows<2>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 4:
+			unswizzle_morton_rows<4>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 8:
+			unswizzle_morton_rows<8>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 16:
+			unswizzle_morton_rows<16>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		default:
+			unswizzle_morton_rows<0>(input, output, output_size, morton, blocks_w, source_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		}
+	});
+}
+
+// Copy every block of the linear surface, row by row, to its Morton position
+// When a side is not a power of two the index bits don't cover the whole surface: blocks
+// beyond the covered area are never read, and every covered block fills all the destination
+// blocks sharing its index bits.
+template <size_t BlockBytes>
+void swizzle_morton_rows(const uint8_t* input, size_t input_size, uint8_t* output, const MortonTables& morton, size_t blocks_w, size_t destination_blocks, size_t block_size_bytes, size_t first_row, size_t end_row) {
+	const size_t blockBytes = BlockBytes ? BlockBytes : block_size_bytes;
+	const size_t columns = std::min(morton.x.size(), blocks_w);
+	const size_t period = size_t(1) << morton.bits;
+
+	for (size_t y = first_row; y < end_row; ++y) {
+		size_t rowOffset = y * blocks_w * blockBytes;
+		if (rowOffset >= input_size) {
+			break;
+		}
+		const uint8_t* row = input + rowOffset;
+		size_t rowColumns = std::min(columns, (input_size - rowOffset) / blockBytes);
+		const size_t rowIndex = morton.y[y];
+
+		for (size_t x = 0; x < rowColumns; ++x) {
+			for (size_t t = morton.x[x] | rowIndex; t < destination_blocks; t += period) {
+				std::memcpy(output + t * blockBytes, row + x * blockBytes, blockBytes);
+			}
+		}
+	}
+}
+
+void swizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height, unsigned int threads) {
+	size_t block_size_bytes = static_cast<size_t>(bytes_per_pixel) * block_width_height * block_width_height;
+
+	size_t blocks_w = width / block_width_height;
+	size_t blocks_h = height / block_width_height;
+	size_t destination_blocks = std::min(blocks_w * blocks_h, output_size / block_size_bytes);
+
+	MortonTables morton = build_morton_tables(blocks_w, blocks_h);
+
+	// Every band covers whole rows of the linear surface
+	const size_t rowBytes = std::max<size_t>(blocks_w * block_size_bytes, 1);
+	runBands(morton.y.size(), MIN_BAND_BYTES / rowBytes, threads, [&](size_t firstRow, size_t endRow) {
+		switch (block_size_bytes) {
+		case 1:
+			swizzle_morton_rows<1>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 2:
+			swizzle_morton_rows<2>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 4:
+			swizzle_morton_rows<4>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 8:
+			swizzle_morton_rows<8>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		case 16:
+			swizzle_morton_rows<16>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		default:
+			swizzle_morton_rows<0>(input, input_size, output, morton, blocks_w, destination_blocks, block_size_bytes, firstRow, endRow);
+			break;
+		}
+	});
+}
+
+// Function to unswizzle a Nintendo Switch block-linear surface
+// The surface is stored as blocks of <block_height> GOBs stacked vertically, each GOB holding 64 bytes x 8 rows
+// in 16-byte runs: the kernel walks the visible rows GOB by GOB and copies those runs straight into the
+// cropped linear output, so the padding to whole GOBs never reaches memory.
+void unswizzle_switch(
+	const uint8_t* input,
+	size_t input_size,
+	uint8_t* output,
+	size_t output_size,
+	int img_width,
+	int img_height,
+	int bytes_per_block,
+	int block_height,
+	unsigned int threads)
+{
+	const size_t rowBytes = static_cast<size_t>(img_width) * bytes_per_block;
+	const size_t paddedRowBytes = (rowBytes + 63) / 64 * 64;
+	const size_t gobsPerRow = paddedRowBytes / 64;
+	const size_t gobRows = 8 * static_cast<size_t>(block_height);
+	const size_t gobBlockSize = 512 * static_cast<size_t>(block_height);
+
+	// Every band covers whole rows of the linear surface
+	runBands(static_cast<size_t>(img_height), MIN_BAND_BYTES / std::max<size_t>(rowBytes, 1), threads, [&](size_t firstRow, size_t endRow) {
+		for (size_t y = firstRow; y < endRow; ++y) {
+			size_t rowAddress = (y / gobRows) * gobBlockSize * gobsPerRow
+				+ ((y % gobRows) / 8) * 512
+				+ ((y % 8) / 2) * 64
+				+ (y % 2) * 16;
+			size_t dstRow = y * rowBytes;
+			// Linear position of this row in the padded surface, which bounds what a truncated input can hold
+			size_t paddedRow = y * paddedRowBytes;
+
+			for (size_t gob = 0; gob < gobsPerRow; ++gob) {
+				for (size_t run = 0; run < 4; ++run) {
+					size_t x = gob * 64 + run * 16;
+					if (x >= rowBytes) {
+						break;
+					}
+					size_t src = rowAddress + gob * gobBlockSize + (run / 2) * 256 + (run % 2) * 32;
+					size_t dst = dstRow + x;
+					size_t count = std::min<size_t>(16, rowBytes - x);
+
+					if (src + count <= input_size && paddedRow + x + count <= input_size && dst + count <= output_size) {
+						std::memcpy(&output[dst], &input[src], count);
+						continue;
+					}
+
+					// Run cut short by the end of the input or output
+					for (size_t k = 0; k < count; k += bytes_per_block) {
+						if (src + k + bytes_per_block <= input_size && paddedRow + x + k + bytes_per_block <= input_size &&
+							dst + k + bytes_per_block <= output_size) {
+							std::memcpy(&output[dst + k], &input[src + k], bytes_per_block);
+						}
+					}
+				}
+			}
+		}
+	});
+}
+
+// Function to swizzle a Nintendo Switch block-linear surface
+// The surface is stored as blocks of <block_height> GOBs stacked vertically, each GOB holding 64 bytes x 8 rows
+// in 16-byte runs: the kernel walks every padded row GOB by GOB, copying the visible part of each run from
+// the cropped linear input and clearing the padding, so no expanded copy of the input is needed.
+void swizzle_switch(
+	const uint8_t* input,
+	size_t input_size,
+	uint8_t* output,
+	size_t output_size,
+	int img_width,
+	int img_height,
+	int bytes_per_block,
+	int block_height,
+	unsigned int threads)
+{
+	const size_t rowBytes = static_cast<size_t>(img_width) * bytes_per_block;
+	const size_t paddedRowBytes = (rowBytes + 63) / 64 * 64;
+	const size_t gobsPerRow = paddedRowBytes / 64;
+	const size_t gobRows = 8 * static_cast<size_t>(block_height);
+	const size_t gobBlockSize = 512 * static_cast<size_t>(block_height);
+	const size_t paddedHeight = (static_cast<size_t>(img_height) + gobRows - 1) / gobRows * gobRows;
+
+	// Every band covers whole padded rows, which land in their own 16-byte runs of the tiled surface
+	runBands(paddedHeight, MIN_BAND_BYTES / std::max<size_t>(paddedRowBytes, 1), threads, [&](size_t firstRow, size_t endRow) {
+		for (size_t y = firstRow; y < endRow; ++y) {
+			size_t rowAddress = (y / gobRows) * gobBlockSize * gobsPerRow
+				+ ((y % gobRows) / 8) * 512
+				+ ((y % 8) / 2) * 64
+				+ (y % 2) * 16;
+			size_t srcRow = y * rowBytes;
+			// Bytes of this row present in the input, in whole blocks
+			size_t visible = 0;
+			if (y < static_cast<size_t>(img_height) && srcRow < input_size) {
+				visible = std::min(rowBytes, (input_size - srcRow) / bytes_per_block * bytes_per_block);
+			}
+
+			for (size_t gob = 0; gob < gobsPerRow; ++gob) {
+				for (size_t run = 0; run < 4; ++run) {
+					size_t x = gob * 64 + run * 16;
+					size_t dst = rowAddress + gob * gobBlockSize + (run / 2) * 256 + (run % 2) * 32;
+					if (dst >= output_size) {
+						continue;
+					}
+					size_t room = std::min<size_t>(16, output_size - dst);
+					size_t count = x < visible ? std::min(room, visible - x) : 0;
+
+					if (count > 0) {
+						std::memcpy(&output[dst], &input[srcRow + x], count);
+					}
+					std::memset(&output[dst + count], 0, room - count);
+				}
+			}
+		}
+	});
+}
+
+// Function to get the block size of a DDS pixel format
+void getBlockInfo(const DDS_PIXELFORMAT& ddspf, int& blockPixelSize, int& bytesPerBlock) {
+	if (ddspf.dwFourCC == 0x31545844) {	// "DXT1"
+		blockPixelSize = 4;
+		bytesPerBlock = 8;
+	} else if (ddspf.dwFourCC >= 0x32545844 && ddspf.dwFourCC <= 0x35545844) {	// "DXT2" to "DXT5"
+		blockPixelSize = 4;
+		bytesPerBlock = 16;
+	} else if (ddspf.dwFourCC == 0x71) {	// A16B16G16R16F
+		blockPixelSize = 1;
+		bytesPerBlock = 8;
+	} else {
+		blockPixelSize = 1;
+		bytesPerBlock = (ddspf.dwRGBBitCount + 7) / 8;
+	}
+}
+
+// Function to get the mip levels of a texture, clamped to one level per halving of its longer side
+int clampMipLevels(uint64_t mipLevels, DWORD width, DWORD height) {
+	uint64_t maxLevels = 1;
+	for (DWORD side = std::max(width, height); side > 1; side >>= 1) {
+		++maxLevels;
+	}
+	return static_cast<int>(std::max<uint64_t>(1, std::min(mipLevels, maxLevels)));
+}
+
+// Function to list every subresource of a texture in DDS order (every mip level of a face, face after face)
+// Xbox 360 and PS3 subresources are stored unpadded, so their tiled size matches the linear one.
+// Nintendo Switch block-linear subresources are padded to whole GOBs (64 bytes x 8 rows) and
+// to a whole block of GOBs vertically. The base level keeps the block height of the format, as the
+// original tools decode it, and the block height only shrinks along the rest of the mip chain.
+std::vector<Subresource> planSurfaceLayout(int width, int height, int mipLevels, int faces, int blockPixelSize, int bytesPerBlock, const std::string& swizzleType, int blockHeight) {
+	std::vector<Subresource> layout;
+	size_t linearOffset = 0;
+	size_t tiledOffset = 0;
+
+	for (int face = 0; face < faces; ++face) {
+		for (int mip = 0; mip < mipLevels; ++mip) {
+			Subresource sub;
+			sub.face = face;
+			sub.mip = mip;
+			sub.width = std::max(1, width >> mip);
+			sub.height = std::max(1, height >> mip);
+
+			size_t widthInBlocks = (sub.width + blockPixelSize - 1) / blockPixelSize;
+			size_t heightInBlocks = (sub.height + blockPixelSize - 1) / blockPixelSize;
+			sub.pitch = widthInBlocks * bytesPerBlock;
+			sub.linearOffset = linearOffset;
+			sub.linearSize = sub.pitch * heightInBlocks;
+			sub.tiledOffset = tiledOffset;
+			sub.tiledSize = sub.linearSize;
+			sub.blockHeight = blockHeight;
+
+			if (swizzleType == "switch") {
+				while (mip > 0 && sub.blockHeight > 1 && heightInBlocks <= static_cast<size_t>(sub.blockHeight) * 4) {
+					sub.blockHeight /= 2;
+				}
+				size_t gobRows = 8 * static_cast<size_t>(sub.blockHeight);
+				sub.tiledSize = ((sub.pitch + 63) / 64 * 64) * ((heightInBlocks + gobRows - 1) / gobRows * gobRows);
+			}
+
+			linearOffset += sub.linearSize;
+			tiledOffset += sub.tiledSize;
+			layout.push_back(sub);
+		}
+	}
+
+	return layout;
+}
+
+// Read-only view of an input file, memory-mapped where the platform allows it
+MappedFile::MappedFile(const std::string& filePath) {
+#ifndef _WIN32
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		length = static_cast<size_t>(st.st_size);
+		if (length == 0) {
+			opened = true;
+		} else {
+			void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping != MAP_FAILED) {
+				bytes = static_cast<const uint8_t*>(mapping);
+				mapped = true;
+				opened = true;
+			}
+		}
+	}
+	close(fd);
+#else
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return;
+	}
+	buffer.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+	bytes = buffer.data();
+	length = buffer.size();
+	opened = true;
+#endif
+}
+
+void MappedFile::prefetch() const {
+#ifndef _WIN32
+	if (!mapped) {
+		return;
+	}
+	madvise(const_cast<uint8_t*>(bytes), length, MADV_WILLNEED);
+
+	// Touch every page, as the advice alone doesn't wait for the data
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	volatile uint8_t sink = 0;
+	for (size_t offset = 0; offset < length; offset += pageSize) {
+		sink = sink + bytes[offset];
+	}
+#endif
+}
+
+void MappedFile::release(size_t offset, size_t size) const {
+#ifndef _WIN32
+	if (!mapped || offset >= length) {
+		return;
+	}
+	// Only the pages lying entirely within the range are dropped
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t start = (offset + pageSize - 1) / pageSize * pageSize;
+	size_t end = std::min(offset + size, length);
+	end = end == length ? (length + pageSize - 1) / pageSize * pageSize : end / pageSize * pageSize;
+	if (start < end) {
+		madvise(const_cast<uint8_t*>(bytes) + start, end - start, MADV_DONTNEED);
+	}
+#else
+	(void)offset;
+	(void)size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+	if (mapped) {
+		munmap(const_cast<uint8_t*>(bytes), length);
+	}
+#endif
+}
+
+// Function to validate the input file
+bool checkFileSignature(ByteSpan file, const std::string& expectedSignature) {
+	if (file.size < 4) {
+		return false;
+	}
+
+	std::stringstream hexStream;
+	for (int i = 0; i < 4; ++i) {
+		hexStream << std::hex << std::setw(2) << std::setfill('0') << (int)file.data[i];
+	}
+
+	return hexStream.str() == expectedSignature;
+}
+
+// Function to validate the DDS file header
+bool validateDDSFile(ByteSpan file) {
+	if (file.size < sizeof(DWORD)) {
+		return false;
+	}
+
+	DWORD magic;
+	std::memcpy(&magic, file.data, sizeof(magic));
+
+	return magic == DDS_MAGIC;
+}
+
+// Function to check whether a file name stands for standard input or output
+bool isStandardStream(const std::string& filePath) {
+	return filePath == "-";
+}
+
+// Function to switch a standard stream to binary mode, on platforms translating line endings
+void setBinaryMode(std::FILE* stream) {
+#ifdef _WIN32
+	_setmode(_fileno(stream), _O_BINARY);
+#else
+	(void)stream;
+#endif
+}
+
+// Function to read up to <count> more bytes of standard input into <data>, fewer at its end
+bool readStandardInput(std::vector<uint8_t>& data, size_t count) {
+	setBinaryMode(stdin);
+	while (count > 0) {
+		size_t size = data.size();
+		size_t wanted = std::min<size_t>(count, 1 << 20);
+		data.resize(size + wanted);
+		size_t bytesRead = std::fread(data.data() + size, 1, wanted, stdin);
+		data.resize(size + bytesRead);
+		count -= bytesRead;
+		if (bytesRead < wanted) {
+			return !std::ferror(stdin);
+		}
+	}
+	return true;
+}
+
+// Function to write blocks of memory to standard output
+bool writeStandardOutput(const std::vector<ByteSpan>& parts) {
+	setBinaryMode(stdout);
+	for (const ByteSpan& part : parts) {
+		if (part.size > 0 && std::fwrite(part.data, 1, part.size, stdout) != part.size) {
+			return false;
+		}
+	}
+	return std::fflush(stdout) == 0;
+}
+
+// Function to write <head>, then the rest of standard input, to <outputFile> through a fixed-size buffer
+bool copyStandardInput(ByteSpan head, const std::string& outputFile, uint64_t& copied) {
+	copied = 0;
+	setBinaryMode(stdin);
+	std::FILE* output = isStandardStream(outputFile) ? stdout : std::fopen(outputFile.c_str(), "wb");
+	if (!output) {
+		return false;
+	}
+	if (output == stdout) {
+		setBinaryMode(stdout);
+	}
+
+	bool success = head.size == 0 || std::fwrite(head.data, 1, head.size, output) == head.size;
+	copied = success ? head.size : 0;
+	std::vector<uint8_t> buffer(1 << 16);
+	while (success) {
+		size_t bytesRead = std::fread(buffer.data(), 1, buffer.size(), stdin);
+		if (bytesRead > 0 && std::fwrite(buffer.data(), 1, bytesRead, output) != bytesRead) {
+			success = false;
+		}
+		copied += bytesRead;
+		if (bytesRead < buffer.size()) {
+			success = success && !std::ferror(stdin);
+			break;
+		}
+	}
+
+	if (output == stdout) {
+		return std::fflush(stdout) == 0 && success;
+	}
+	return std::fclose(output) == 0 && success;
+}
+
+// Function to write a whole output file, "-" for standard output
+bool writeFile(const std::string& filePath, const std::vector<uint8_t>& data) {
+	if (isStandardStream(filePath)) {
+		return writeStandardOutput({ByteSpan{data.data(), data.size()}});
+	}
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+	return !file.fail();
+}
+
+// Function to write an output file from several blocks of memory, with a single system call where the platform allows it
+bool writeFile(const std::string& filePath, const std::vector<ByteSpan>& parts) {
+	if (isStandardStream(filePath)) {
+		return writeStandardOutput(parts);
+	}
+#ifndef _WIN32
+	int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+
+	std::vector<struct iovec> vectors;
+	for (const ByteSpan& part : parts) {
+		if (part.size > 0) {
+			vectors.push_back(iovec{const_cast<uint8_t*>(part.data), part.size});
+		}
+	}
+
+	// Resume after short writes
+	bool success = true;
+	size_t first = 0;
+	while (first < vectors.size()) {
+		ssize_t written = writev(fd, vectors.data() + first, static_cast<int>(std::min<size_t>(vectors.size() - first, IOV_MAX)));
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			success = false;
+			break;
+		}
+		size_t remaining = static_cast<size_t>(written);
+		while (first < vectors.size() && remaining >= vectors[first].iov_len) {
+			remaining -= vectors[first].iov_len;
+			++first;
+		}
+		if (first < vectors.size()) {
+			vectors[first].iov_base = static_cast<uint8_t*>(vectors[first].iov_base) + remaining;
+			vectors[first].iov_len -= remaining;
+		}
+	}
+	return close(fd) == 0 && success;
+#else
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	for (const ByteSpan& part : parts) {
+		file.write(reinterpret_cast<const char*>(part.data), part.size);
+	}
+	file.close();
+	return !file.fail();
+#endif
+}
+
+// Output file written piece by piece, "-" for standard output
+OutputFile::~OutputFile() {
+	close();
+}
+
+bool OutputFile::write(ByteSpan data) {
+	if (!file && !failed) {
+		if (isStandardStream(path)) {
+			setBinaryMode(stdout);
+			file = stdout;
+		} else {
+			createDirectories(std::filesystem::path(path).parent_path().string());
+			file = std::fopen(path.c_str(), "wb");
+		}
+		opened = file != nullptr;
+		failed = !opened;
+	}
+	if (failed) {
+		return false;
+	}
+	if (data.size > 0 && std::fwrite(data.data, 1, data.size, file) != data.size) {
+		failed = true;
+	}
+	return !failed;
+}
+
+bool OutputFile::close() {
+	if (file) {
+		bool closed = file == stdout ? std::fflush(stdout) == 0 : std::fclose(file) == 0;
+		file = nullptr;
+		failed = failed || !closed;
+	}
+	return !failed;
+}
+
+void OutputFile::discard() {
+	close();
+	std::error_code ec;
+	if (opened && !isStandardStream(path) && std::filesystem::is_regular_file(path, ec)) {
+		std::filesystem::remove(path, ec);
+	}
+}
+
+// Function to copy <inputFile>, from <offset> to its end, to <outputFile> ("-" for standard output)
+// On Linux the data is moved inside the kernel (copy_file_range, or sendfile across file systems that don't
+// support it), without passing through user space. Elsewhere it is copied through a buffer.
+bool copyFileTail(const std::string& inputFile, uint64_t offset, const std::string& outputFile, uint64_t& copied) {
+	copied = 0;
+#ifndef _WIN32
+	int input = open(inputFile.c_str(), O_RDONLY);
+	if (input < 0) {
+		return false;
+	}
+	struct stat st;
+	int output = -1;
+	if (fstat(input, &st) == 0) {
+		if (isStandardStream(outputFile)) {
+			std::fflush(stdout);	// Keep the order of the data already written through stdio
+			output = dup(STDOUT_FILENO);
+		} else {
+			output = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		}
+	}
+	if (output < 0) {
+		close(input);
+		return false;
+	}
+
+	uint64_t size = static_cast<uint64_t>(st.st_size);
+	off_t position = static_cast<off_t>(std::min(offset, size));
+	bool success = true;
+#ifdef __linux__
+	bool kernelCopy = true;
+	bool useSendfile = false;
+	while (kernelCopy && static_cast<uint64_t>(position) < size) {
+		size_t length = static_cast<size_t>(std::min<uint64_t>(size - position, 1 << 30));
+		ssize_t moved = useSendfile ? sendfile(output, input, &position, length)
+			: copy_file_range(input, &position, output, nullptr, length, 0);
+		if (moved > 0) {
+			copied += static_cast<uint64_t>(moved);
+		} else if (moved < 0 && errno == EINTR) {
+			continue;
+		} else if (moved < 0 && copied == 0 && !useSendfile && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP || errno == EBADF)) {
+			useSendfile = true;
+		} else if (moved < 0 && copied == 0 && useSendfile && (errno == EINVAL || errno == ENOSYS)) {
+			kernelCopy = false;	// Fall back to a buffered copy
+		} else {
+			success = moved == 0 && static_cast<uint64_t>(position) == size;
+			break;
+		}
+	}
+#endif
+	std::vector<uint8_t> buffer;
+	while (success && static_cast<uint64_t>(position) < size) {
+		buffer.resize(1 << 20);
+		ssize_t bytesRead = pread(input, buffer.data(), buffer.size(), position);
+		if (bytesRead <= 0) {
+			success = bytesRead < 0 && errno == EINTR;
+			continue;
+		}
+		for (ssize_t done = 0; success && done < bytesRead; ) {
+			ssize_t written = write(output, buffer.data() + done, static_cast<size_t>(bytesRead - done));
+			if (written < 0 && errno != EINTR) {
+				success = false;
+			} else if (written > 0) {
+				done += written;
+			}
+		}
+		position += bytesRead;
+		copied += static_cast<uint64_t>(bytesRead);
+	}
+
+	close(input);
+	return close(output) == 0 && success;
+#else
+	std::ifstream input(inputFile, std::ios::binary);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+	if (isStandardStream(outputFile)) {
+		setBinaryMode(stdout);
+		std::vector<char> buffer(1 << 16);
+		while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+			size_t bytesRead = static_cast<size_t>(input.gcount());
+			if (std::fwrite(buffer.data(), 1, bytesRead, stdout) != bytesRead) {
+				return false;
+			}
+			copied += bytesRead;
+		}
+		return std::fflush(stdout) == 0;
+	}
+	std::ofstream output(outputFile, std::ios::binary);
+	if (!output.is_open()) {
+		return false;
+	}
+	output << input.rdbuf();
+	copied = static_cast<uint64_t>(output.tellp());
+	output.close();
+	return !output.fail();
+#endif
+}
+
+// Function to create output directory
+void createDirectories(const std::string& path) {
+	if (!path.empty()) {	// Files in the current directory have no parent path
+		std::filesystem::create_directories(path);
+	}
+}
+
+// MurmurHash3 x64 128-bit, by Austin Appleby (public domain)
+inline uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k) {
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+Digest hashBytes(ByteSpan data, uint64_t seed) {
+	const uint64_t c1 = 0x87c37b91114253d5ULL;
+	const uint64_t c2 = 0x4cf5ad432745937fULL;
+	const size_t blocks = data.size / 16;
+	uint64_t h1 = seed;
+	uint64_t h2 = seed;
+
+	for (size_t i = 0; i < blocks; ++i) {
+		uint64_t k1, k2;
+		std::memcpy(&k1, data.data + i * 16, 8);
+		std::memcpy(&k2, data.data + i * 16 + 8, 8);
+
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+		h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+	}
+
+	// Tail of less than 16 bytes
+	const uint8_t* tail = data.data + blocks * 16;
+	uint64_t k1 = 0;
+	uint64_t k2 = 0;
+	switch (data.size & 15) {
+	case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+	case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+	case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+	case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+	case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+	case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+	case 9: k2 ^= uint64_t(tail[8]);
+		k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+		[[fallthrough]];
+	case 8: k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+	case 7: k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+	case 6: k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+	case 5: k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+	case 4: k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+	case 3: k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+	case 2: k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+	case 1: k1 ^= uint64_t(tail[0]);
+		k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+	}
+
+	h1 ^= data.size;
+	h2 ^= data.size;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+
+	Digest digest;
+	digest.low = h1;
+	digest.high = h2;
+	return digest;
+}
+
+std::string Digest::hex() const {
+	std::stringstream hexStream;
+	hexStream << std::hex << std::setw(16) << std::setfill('0') << low << std::setw(16) << std::setfill('0') << high;
+	return hexStream.str();
+}
+
+ConversionCache::ConversionCache(const std::string& directory, uint64_t maxBytes)
+	: directory(directory), maxBytes(maxBytes) {
+}
+
+std::string ConversionCache::key(ByteSpan input, const std::string& tool, const std::string& options) const {
+	return key(hashBytes(input), tool, options);
+}
+
+std::string ConversionCache::key(const Digest& input, const std::string& tool, const std::string& options) const {
+	std::string material = tool + "\n" + options + "\n" + input.hex();
+	return hashBytes(ByteSpan{reinterpret_cast<const uint8_t*>(material.data()), material.size()}).hex();
+}
+
+// Entries are spread over 256 subdirectories named after the first byte of their key
+std::string ConversionCache::entryPath(const std::string& key) const {
+	return (std::filesystem::path(directory) / key.substr(0, 2) / key).string();
+}
+
+bool ConversionCache::load(const std::string& key, std::vector<uint8_t>& output) {
+	std::string path = entryPath(key);
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+	output.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	if (!file.read(reinterpret_cast<char*>(output.data()), output.size())) {
+		return false;
+	}
+
+	// Mark the entry as recently used
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+	return true;
+}
+
+void ConversionCache::store(const std::string& key, const std::vector<uint8_t>& data) {
+	std::string path = entryPath(key);
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+	// Entries appear atomically, so concurrent readers never see a partial one
+	std::stringstream temporary;
+	temporary << path << ".tmp" << std::this_thread::get_id();
+	if (!writeFile(temporary.str(), data)) {
+		std::filesystem::remove(temporary.str(), ec);
+		return;
+	}
+	std::filesystem::rename(temporary.str(), path, ec);
+	if (ec) {
+		std::filesystem::remove(temporary.str(), ec);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	totalBytes += data.size();
+	if (!scanned || totalBytes > maxBytes) {
+		evict();
+	}
+}
+
+// Function to drop the least recently used entries once the cache grows past its size limit
+// Called with the mutex held. The directory is rescanned every time, as other processes may share it,
+// and trimmed to 90% of the limit so that the next few stores don't trigger another scan.
+void ConversionCache::evict() {
+	struct Entry {
+		std::filesystem::file_time_type time;
+		uint64_t size;
+		std::filesystem::path path;
+	};
+	std::vector<Entry> entries;
+	std::error_code ec;
+
+	totalBytes = 0;
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+		if (it->is_regular_file(ec) && it->path().filename().string().find(".tmp") == std::string::npos) {
+			Entry entry = { it->last_write_time(ec), it->file_size(ec), it->path() };
+			totalBytes += entry.size;
+			entries.push_back(entry);
+		}
+	}
+	scanned = true;
+
+	if (totalBytes <= maxBytes) {
+		return;
+	}
+
+	const uint64_t target = maxBytes - maxBytes / 10;
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+	for (const Entry& entry : entries) {
+		if (totalBytes <= target) {
+			break;
+		}
+		if (std::filesystem::remove(entry.path, ec)) {
+			totalBytes -= entry.size;
+		}
+	}
+}
+
+// Function to read the first <count> bytes of a file (fewer if the file is shorter) and its size, with a single read
+bool readFileHead(const std::string& filePath, size_t count, std::vector<uint8_t>& head, uint64_t& fileSize) {
+#ifndef _WIN32
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	bool success = fstat(fd, &st) == 0;
+	if (success) {
+		fileSize = static_cast<uint64_t>(st.st_size);
+		head.resize(std::min<uint64_t>(count, fileSize));
+		ssize_t bytesRead = head.empty() ? 0 : pread(fd, head.data(), head.size(), 0);
+		success = bytesRead >= 0;
+		head.resize(success ? static_cast<size_t>(bytesRead) : 0);
+	}
+	close(fd);
+	return success;
+#else
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+	fileSize = static_cast<uint64_t>(file.tellg());
+	head.resize(std::min<uint64_t>(count, fileSize));
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(head.data()), head.size());
+	head.resize(static_cast<size_t>(file.gcount()));
+	return true;
+#endif
+}
+
+// Function to get the size and modification time of a file
+bool statFile(const std::string& path, uint64_t& size, int64_t& mtime) {
+	std::error_code ec;
+	size = std::filesystem::file_size(path, ec);
+	if (ec) {
+		return false;
+	}
+	mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+	return !ec;
+}
+
+BatchManifest::BatchManifest(const std::string& path, const std::string& fingerprint)
+	: path(path), fingerprint(fingerprint) {
+}
+
+// The manifest is a text file: a header line with the fingerprint, then one line per input,
+// "<size>\t<mtime>\t<digest>\t<input>\t<output>"
+void BatchManifest::load() {
+	std::ifstream file(path);
+	std::string line;
+	if (!file.is_open() || !std::getline(file, line) || line != "# gbtvgr manifest\t" + fingerprint) {
+		return;
+	}
+
+	while (std::getline(file, line)) {
+		std::stringstream fields(line);
+		Entry entry;
+		std::string input;
+		fields >> entry.size >> entry.mtime >> entry.digest;
+		if (fields.get() != '\t' || !std::getline(fields, input, '\t') || !std::getline(fields, entry.output)) {
+			continue;
+		}
+		previous[input] = entry;
+	}
+}
+
+bool BatchManifest::save() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "# gbtvgr manifest\t" << fingerprint << "\n";
+	for (const auto& item : current) {
+		const Entry& entry = item.second;
+		file << entry.size << "\t" << entry.mtime << "\t" << entry.digest << "\t" << item.first << "\t" << entry.output << "\n";
+	}
+	file.close();
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	return !file.fail() && !ec;
+}
+
+bool BatchManifest::isUpToDate(const std::string& input, const std::string& output) {
+	auto it = previous.find(input);
+	if (it == previous.end() || it->second.output != output || !std::filesystem::exists(output)) {
+		return false;
+	}
+
+	uint64_t size;
+	int64_t mtime;
+	if (!statFile(input, size, mtime) || size != it->second.size || mtime != it->second.mtime) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	current[input] = it->second;
+	return true;
+}
+
+bool BatchManifest::isUpToDate(const std::string& input, const std::string& output, const Digest& digest) {
+	auto it = previous.find(input);
+	if (it == previous.end() || it->second.output != output || it->second.digest != digest.hex() || !std::filesystem::exists(output)) {
+		return false;
+	}
+
+	record(input, output, digest);
+	return true;
+}
+
+void BatchManifest::record(const std::string& input, const std::string& output, const Digest& digest) {
+	Entry entry;
+	if (!statFile(input, entry.size, entry.mtime)) {
+		return;
+	}
+	entry.digest = digest.hex();
+	entry.output = output;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	current[input] = entry;
+}
+
+ConversionStats::ConversionStats(bool keepSpans)
+	: started(Clock::now()), keepSpans(keepSpans) {
+}
+
+void ConversionStats::record(const std::string& stage, const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes) {
+	add(stage, file, start, end, bytes, false);
+}
+
+void ConversionStats::recordFile(const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes) {
+	add("file", file, start, end, bytes, true);
+}
+
+void ConversionStats::add(const std::string& stage, const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes, bool wholeFile) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = totals.find(stage);
+	if (it == totals.end()) {
+		stageOrder.push_back(stage);
+		it = totals.emplace(stage, Totals()).first;
+	}
+	it->second.count++;
+	it->second.time += end - start;
+	it->second.bytes += bytes;
+
+	if (keepSpans) {
+		int thread = 0;
+		if (!wholeFile) {
+			thread = threads.emplace(std::this_thread::get_id(), static_cast<int>(threads.size()) + 1).first->second;
+		}
+		spans.push_back(Span{stage, file, start, end, bytes, thread});
+	}
+}
+
+// Stage times add up the time spent by every thread, so with several threads they can exceed the wall time
+void ConversionStats::printSummary(std::ostream& out) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	double wallTime = std::chrono::duration<double>(Clock::now() - started).count();
+
+	out << std::endl;
+	out << std::left << std::setw(12) << "Stage" << std::right << std::setw(10) << "Runs" << std::setw(12) << "Time (s)"
+		<< std::setw(14) << "Bytes (MB)" << std::setw(12) << "MB/s" << std::endl;
+	for (const std::string& stage : stageOrder) {
+		const Totals& stageTotals = totals.at(stage);
+		double time = std::chrono::duration<double>(stageTotals.time).count();
+		double megabytes = stageTotals.bytes / (1024.0 * 1024.0);
+		out << std::left << std::setw(12) << stage << std::right << std::setw(10) << stageTotals.count
+			<< std::fixed << std::setprecision(3) << std::setw(12) << time << std::setw(14) << megabytes
+			<< std::setprecision(1) << std::setw(12) << (time > 0 ? megabytes / time : 0.0) << std::endl;
+	}
+	out << "Wall time: " << std::fixed << std::setprecision(3) << wallTime << " s" << std::endl;
+}
+
+bool ConversionStats::saveTrace(const std::string& path) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	// Stages are complete ("X") events on the track of their thread, whole files are async ("b" and "e")
+	// events since they overlap each other. Times are in microseconds from the start of the run.
+	file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	file << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < spans.size(); ++i) {
+		const Span& span = spans[i];
+		double start = std::chrono::duration<double, std::micro>(span.start - started).count();
+		double end = std::chrono::duration<double, std::micro>(span.end - started).count();
+		std::string args = "\"args\": {\"file\": " + jsonString(span.file) + ", \"bytes\": " + std::to_string(span.bytes) + "}";
+		if (span.thread != 0) {
+			file << "{\"name\": " << jsonString(span.stage) << ", \"cat\": \"stage\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << span.thread
+				 << ", \"ts\": " << start << ", \"dur\": " << end - start << ", " << args << "}";
+		} else {
+			file << "{\"name\": " << jsonString(span.file) << ", \"cat\": \"file\", \"ph\": \"b\", \"id\": " << i << ", \"pid\": 1, \"tid\": 0"
+				 << ", \"ts\": " << start << ", " << args << "},\n";
+			file << "{\"name\": " << jsonString(span.file) << ", \"cat\": \"file\", \"ph\": \"e\", \"id\": " << i << ", \"pid\": 1, \"tid\": 0"
+				 << ", \"ts\": " << end << "}";
+		}
+		file << (i + 1 < spans.size() ? "," : "") << "\n";
+	}
+	file << "]}\n";
+
+	file.close();
+	return !file.fail();
+}
+
+// Function to quote a string for JSON output
+std::string jsonString(const std::string& text) {
+	std::stringstream quoted;
+	quoted << '"';
+	for (unsigned char c : text) {
+		if (c == '"' || c == '\\') {
+			quoted << '\\' << c;
+		} else if (c < 0x20) {
+			quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+		} else {
+			quoted << c;
+		}
+	}
+	quoted << '"';
+	return quoted.str();
+}
+
+// Function to get the error class of an exit code returned by a conversion, empty on success
+std::string conversionErrorClass(int exitCode) {
+	switch (exitCode) {
+	case 0:
+		return "";
+	case 1:
+		return "unsupported";
+	case 3:
+		return "invalid";
+	case 5:
+	case 7:
+	case 9:
+		return "compression";
+	default:
+		return "exception";
+	}
+}
+
+// Function to fail a report with <errorClass> and <error>, returning <exitCode>
+int failReport(FileReport* report, int exitCode, const std::string& errorClass, const std::string& error) {
+	if (report) {
+		report->status = "failed";
+		report->exitCode = exitCode;
+		report->errorClass = errorClass;
+		report->error = error;
+	}
+	return exitCode;
+}
+
+// Function to print a report as a single line of JSON, atomically with respect to other threads
+void printFileReport(std::ostream& out, const FileReport& report) {
+	std::stringstream line;
+	line << "{\"input\": " << jsonString(report.input) << ", \"output\": " << jsonString(report.output)
+		 << ", \"status\": " << jsonString(report.status);
+	if (!report.texture.container.empty()) {
+		line << ", \"format\": " << report.texture.texFormat << ", \"platform\": " << jsonString(report.texture.platform)
+			 << ", \"width\": " << report.texture.width << ", \"height\": " << report.texture.height
+			 << ", \"mips\": " << report.texture.mipLevels;
+	}
+	line << ", \"input_bytes\": " << report.inputBytes << ", \"output_bytes\": " << report.outputBytes
+		 << ", \"seconds\": " << std::fixed << std::setprecision(6) << report.seconds
+		 << ", \"exit_code\": " << report.exitCode;
+	if (report.errorClass.empty()) {
+		line << ", \"error_class\": null, \"error\": null}\n";
+	} else {
+		line << ", \"error_class\": " << jsonString(report.errorClass) << ", \"error\": " << jsonString(report.error) << "}\n";
+	}
+
+	static std::mutex outputMutex;
+	std::lock_guard<std::mutex> lock(outputMutex);
+	out << line.str() << std::flush;
+}
+
+// Function to run the conversion of <input> to <output>, reporting its exceptions as failed conversions
+int runReportedConversion(const std::string& input, const std::string& output, bool json, const std::function<int(FileReport&)>& convert) {
+	FileReport report;
+	report.input = input;
+	report.output = output;
+
+	auto started = std::chrono::steady_clock::now();
+	int result;
+	try {
+		result = convert(report);
+	} catch (const std::exception& e) {
+		std::cerr << "* ERROR: " << input << ": " << e.what() << std::endl;
+		result = failReport(&report, 1, "exception", e.what());
+	}
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	if (json) {
+		printFileReport(std::cout, report);
+	}
+	return result;
+}
+
+// Function to run <convert> for every index below <count>, spreading the work across <jobs> threads
+std::vector<int> runBatchJobs(size_t count, unsigned int jobs, const std::function<int(size_t)>& convert) {
+	if (jobs == 0) {
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
+	jobs = static_cast<unsigned int>(std::min<size_t>(jobs, std::max<size_t>(count, 1)));
+
+	std::vector<int> results(count, 0);
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) {
+			results[i] = convert(i);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < jobs; ++t) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+
+	return results;
+}
+
+// Queue of batch entries between two pipeline stages
+// push() waits while <capacity> entries are queued; pop() waits for an entry and fails once the queue
+// is closed and empty.
+class BatchQueue {
+public:
+	explicit BatchQueue(size_t capacity) : capacity(capacity) {
+	}
+
+	void push(size_t index) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this]() { return entries.size() < capacity; });
+		entries.push_back(index);
+		notEmpty.notify_one();
+	}
+
+	bool pop(size_t& index) {
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this]() { return !entries.empty() || closed; });
+		if (entries.empty()) {
+			return false;
+		}
+		index = entries.front();
+		entries.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+	}
+
+private:
+	size_t capacity;
+	std::deque<size_t> entries;
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+
+// Function to run a batch as overlapping read, convert and write stages
+std::vector<int> runBatchPipeline(size_t count, unsigned int jobs, size_t depth, const std::function<int(size_t)>& read, const std::function<int(size_t)>& convert, const std::function<int(size_t)>& write) {
+	if (jobs == 0) {
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
+	jobs = static_cast<unsigned int>(std::min<size_t>(jobs, std::max<size_t>(count, 1)));
+	if (depth == 0) {
+		depth = 2 * static_cast<size_t>(jobs);
+	}
+
+	// Every entry gets its result from the stage that ends it, so no two threads write the same one
+	std::vector<int> results(count, 0);
+	BatchQueue readQueue(depth);
+	BatchQueue convertedQueue(depth);
+	std::atomic<unsigned int> runningWorkers(jobs);
+
+	std::thread reader([&]() {
+		for (size_t i = 0; i < count; ++i) {
+			int result = read(i);
+			if (result == 0) {
+				readQueue.push(i);
+			} else {
+				results[i] = result == BATCH_SKIP ? 0 : result;
+			}
+		}
+		readQueue.close();
+	});
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < jobs; ++t) {
+		workers.emplace_back([&]() {
+			size_t i;
+			while (readQueue.pop(i)) {
+				int result = convert(i);
+				if (result == 0) {
+					convertedQueue.push(i);
+				} else {
+					results[i] = result == BATCH_SKIP ? 0 : result;
+				}
+			}
+			if (--runningWorkers == 0) {
+				convertedQueue.close();
+			}
+		});
+	}
+
+	// The calling thread writes
+	size_t i;
+	while (convertedQueue.pop(i)) {
+		int result = write(i);
+		results[i] = result == BATCH_SKIP ? 0 : result;
+	}
+
+	reader.join();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+
+	return results;
+}
+
+// Function to take the most recently released buffer out of the pool, so that its pages are likely still cached
+std::vector<uint8_t> BufferPool::acquire() {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (buffers.empty()) {
+		return std::vector<uint8_t>();
+	}
+	std::vector<uint8_t> buffer = std::move(buffers.back());
+	buffers.pop_back();
+	retainedBytes -= buffer.capacity();
+	return buffer;
+}
+
+// Function to give a buffer back to the pool, freeing it if the pool already holds its share of memory
+void BufferPool::release(std::vector<uint8_t>& buffer) {
+	std::vector<uint8_t> released;
+	released.swap(buffer);
+	if (released.capacity() == 0) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (retainedBytes + released.capacity() <= maxBytes) {
+		retainedBytes += released.capacity();
+		buffers.push_back(std::move(released));
+	}
+}
+
+// Function to collect the input files of a batch run
+// <batchSource> is either a directory, scanned recursively for files with the given extension,
+// or a text file listing one input file per line.
+std::vector<std::string> collectBatchFiles(const std::string& batchSource, const std::string& extension) {
+	std::vector<std::string> files;
+
+	auto hasExtension = [&extension](const std::filesystem::path& path) {
+		std::string ext = path.extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(),
+						[](unsigned char c) { return std::tolower(c); });
+		return ext == extension;
+	};
+
+	if (std::filesystem::is_directory(batchSource)) {
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(batchSource)) {
+			if (entry.is_regular_file() && hasExtension(entry.path())) {
+				files.push_back(entry.path().string());
+			}
+		}
+		std::sort(files.begin(), files.end());
+	} else {
+		std::ifstream list(batchSource);
+		if (!list.is_open()) {
+			std::cerr << "* ERROR: Unable to open batch list: " << batchSource << std::endl;
+			return files;
+		}
+		std::string line;
+		while (std::getline(list, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!line.empty()) {
+				files.push_back(line);
+			}
+		}
+	}
+
+	return files;
+}
+
+// Function to get the output file of a batch entry
+// Without an output directory the file is written next to its input, otherwise the
+// directory layout below <batchSource> is mirrored into <outputDir>.
+std::string batchOutputFile(const std::string& inputFile, const std::string& batchSource, const std::string& outputDir, const std::string& extension) {
+	std::filesystem::path outputPath(inputFile);
+	if (!outputDir.empty()) {
+		std::filesystem::path relative = std::filesystem::is_directory(batchSource)
+			? std::filesystem::path(inputFile).lexically_relative(batchSource)
+			: std::filesystem::path(inputFile).relative_path();
+		outputPath = std::filesystem::path(outputDir) / relative;
+	}
+	return outputPath.replace_extension(extension).string();
+}
+
+// Function to get the name of the pack entry of a batch input
+std::string packEntryName(const std::string& inputFile, const std::string& packSource) {
+	std::filesystem::path name = std::filesystem::is_directory(packSource)
+		? std::filesystem::path(inputFile).lexically_relative(packSource)
+		: std::filesystem::path(inputFile).relative_path();
+	return name.generic_string();
+}
+
+// Function to get the hash of a pack entry name
+uint64_t packNameHash(const std::string& name) {
+	return hashBytes(ByteSpan{reinterpret_cast<const uint8_t*>(name.data()), name.size()}).low;
+}
+
+// Function to write a pack of <kind> holding every file of <inputs>, in a single sequential pass
+int writePack(const std::string& packFile, DWORD kind, std::vector<PackInput> inputs, std::string& error) {
+	auto align = [](uint64_t offset) {
+		return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+	};
+
+	// Lay the files out in the order of <inputs>, after the index and the names
+	std::string names;
+	for (PackInput& input : inputs) {
+		input.entry.qwNameHash = packNameHash(input.name);
+		input.entry.dwNameOffset = static_cast<DWORD>(names.size());
+		input.entry.dwNameSize = static_cast<DWORD>(input.name.size());
+		names += input.name;
+	}
+	if (inputs.size() > UINT32_MAX || names.size() > UINT32_MAX) {
+		error = "Too many files for a single pack";
+		return 1;
+	}
+
+	PACK_Header header;
+	header.dwKind = kind;
+	header.dwEntryCount = static_cast<DWORD>(inputs.size());
+	header.qwNamesOffset = sizeof(PACK_Header) + inputs.size() * sizeof(PACK_Entry);
+	header.qwNamesSize = names.size();
+	header.qwDataOffset = align(header.qwNamesOffset + header.qwNamesSize);
+	uint64_t offset = header.qwDataOffset;
+	for (PackInput& input : inputs) {
+		input.entry.qwOffset = offset;
+		offset = align(offset + input.entry.qwSize);
+	}
+	header.qwPackSize = offset;
+
+	// Sort the index by name hash, then name, so that entries can be looked up with a binary search
+	std::vector<size_t> order(inputs.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&inputs](size_t a, size_t b) {
+		if (inputs[a].entry.qwNameHash != inputs[b].entry.qwNameHash) {
+			return inputs[a].entry.qwNameHash < inputs[b].entry.qwNameHash;
+		}
+		return inputs[a].name < inputs[b].name;
+	});
+	std::vector<PACK_Entry> index;
+	index.reserve(inputs.size());
+	for (size_t i : order) {
+		if (!index.empty() && inputs[i].name == inputs[order[index.size() - 1]].name) {
+			error = "Duplicate entry name: " + inputs[i].name;
+			return 3;
+		}
+		index.push_back(inputs[i].entry);
+	}
+
+	// Write the header, index and names, then every file
+	// The pack appears atomically once complete, so a failed run leaves any previous pack in place.
+	std::string temporary = packFile + ".tmp";
+	std::ofstream file(temporary, std::ios::binary);
+	if (!file.is_open()) {
+		error = "Unable to open output file: " + packFile;
+		return 1;
+	}
+	const char padding[PACK_ALIGNMENT] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(PACK_Header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(PACK_Entry));
+	file.write(names.data(), names.size());
+	file.write(padding, header.qwDataOffset - header.qwNamesOffset - header.qwNamesSize);
+
+	int result = 0;
+	for (const PackInput& input : inputs) {
+		MappedFile inputFile(input.path);
+		if (!inputFile.is_open()) {
+			error = "Unable to open file: " + input.path;
+			result = 3;
+			break;
+		}
+		if (inputFile.size() != input.entry.qwSize) {
+			error = "File changed while packing: " + input.path;
+			result = 3;
+			break;
+		}
+		file.write(reinterpret_cast<const char*>(inputFile.data()), inputFile.size());
+		file.write(padding, align(inputFile.size()) - inputFile.size());
+		if (file.fail()) {
+			break;
+		}
+	}
+	file.close();
+	if (result == 0 && file.fail()) {
+		error = "Unable to write output file: " + packFile;
+		result = 1;
+	}
+
+	std::error_code ec;
+	if (result == 0) {
+		std::filesystem::rename(temporary, packFile, ec);
+		if (ec) {
+			error = "Unable to write output file: " + packFile;
+			result = 1;
+		}
+	}
+	if (result != 0) {
+		std::filesystem::remove(temporary, ec);
+	}
+	return result;
+}
+
+// Function to check whether a file starts like a pack
+bool isPackFile(const std::string& filePath) {
+	std::vector<uint8_t> head;
+	uint64_t fileSize;
+	if (std::filesystem::is_directory(filePath) || !readFileHead(filePath, sizeof(DWORD), head, fileSize) || head.size() < sizeof(DWORD)) {
+		return false;
+	}
+	DWORD magic;
+	std::memcpy(&magic, head.data(), sizeof(DWORD));
+	return magic == PACK_MAGIC;
+}
+
+PackFile::PackFile(const std::string& filePath) : file(filePath) {
+	if (!file.is_open() || file.size() < sizeof(PACK_Header)) {
+		return;
+	}
+	std::memcpy(&header, file.data(), sizeof(PACK_Header));
+
+	uint64_t indexEnd = sizeof(PACK_Header) + static_cast<uint64_t>(header.dwEntryCount) * sizeof(PACK_Entry);
+	valid = header.dwMagic == PACK_MAGIC && header.dwVersion == PACK_VERSION && header.qwPackSize == file.size()
+		&& header.qwNamesOffset == indexEnd && indexEnd <= file.size()
+		&& header.qwNamesSize <= file.size() - indexEnd
+		&& header.qwDataOffset >= indexEnd + header.qwNamesSize && header.qwDataOffset <= file.size();
+}
+
+// Function to read the entry at <index> of the index, false if it is out of range or points outside the pack
+bool PackFile::entry(size_t index, PACK_Entry& entry) const {
+	if (!valid || index >= header.dwEntryCount) {
+		return false;
+	}
+	std::memcpy(&entry, file.data() + sizeof(PACK_Header) + index * sizeof(PACK_Entry), sizeof(PACK_Entry));
+	return entry.qwOffset >= header.qwDataOffset && entry.qwOffset <= header.qwPackSize
+		&& entry.qwSize <= header.qwPackSize - entry.qwOffset
+		&& static_cast<uint64_t>(entry.dwNameOffset) + entry.dwNameSize <= header.qwNamesSize;
+}
+
+// Function to find the entry named <name>, with a binary search of the index
+bool PackFile::find(const std::string& name, PACK_Entry& entry) const {
+	if (!valid) {
+		return false;
+	}
+	uint64_t hash = packNameHash(name);
+
+	// Find the first entry with the hash of <name>, then compare the names of the entries sharing it
+	size_t first = 0;
+	size_t count = header.dwEntryCount;
+	while (count > 0) {
+		size_t step = count / 2;
+		PACK_Entry middle;
+		std::memcpy(&middle, file.data() + sizeof(PACK_Header) + (first + step) * sizeof(PACK_Entry), sizeof(PACK_Entry));
+		if (middle.qwNameHash < hash) {
+			first += step + 1;
+			count -= step + 1;
+		} else {
+			count = step;
+		}
+	}
+	for (; first < header.dwEntryCount && this->entry(first, entry) && entry.qwNameHash == hash; ++first) {
+		if (entryName(entry) == name) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string PackFile::entryName(const PACK_Entry& entry) const {
+	return std::string(reinterpret_cast<const char*>(file.data() + header.qwNamesOffset + entry.dwNameOffset), entry.dwNameSize);
+}
+
+ByteSpan PackFile::entryData(const PACK_Entry& entry) const {
+	return ByteSpan{file.data() + entry.qwOffset, static_cast<size_t>(entry.qwSize)};
+}
+
+// Helper function to map DDS pixel format to TEX format codes
+DWORD mapDDSPixelFormatToTEX(const DDS_PIXELFORMAT& ddsPixelFormat, DWORD cubemapFlag, const std::string& platform, std::string& error) {
+	//std::cout << "dwFourCC: " << ddsPixelFormat.dwFourCC << std::endl;
+	//std::cout << "dwRGBBitCount: " << ddsPixelFormat.dwRGBBitCount << std::endl;
+	//std::cout << "dwRBitMask: " << ddsPixelFormat.dwRBitMask << std::endl;
+	//std::cout << "dwGBitMask: " << ddsPixelFormat.dwGBitMask << std::endl;
+	//std::cout << "dwBBitMask: " << ddsPixelFormat.dwBBitMask << std::endl;
+	//std::cout << "dwABitMask: " << ddsPixelFormat.dwABitMask << std::endl;
+	if (ddsPixelFormat.dwFourCC == 0x31545844) {	// "DXT1"
+		if (platform == "pc") {
+			return 0x2b;
+		} else if (platform == "ps3") {
+			return 0x2c;
+		} else if (platform == "xbox360") {
+			return 0x28;
+		}
+	}
+	if (ddsPixelFormat.dwFourCC == 0x33545844) {	// "DXT3"
+		return 0x17;
+	}
+	if (ddsPixelFormat.dwFourCC == 0x35545844) {	// "DXT5"
+		if (platform == "pc") {
+			return 0x32;
+		} else if (platform == "ps3") {
+			return 0x34;
+		} else if (platform == "xbox360") {
+			return 0x33;
+		}
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 32 && ddsPixelFormat.dwRBitMask == 0x00FF0000) {	// A8R8G8B8
+		if (platform == "pc") {
+			return cubemapFlag ? 0x18 : 0x03;	// (0x18 if cubemap)
+		} else if (platform == "ps3") {
+			return cubemapFlag ? 0x26 : 0x27;	// (0x26 if cubemap)
+		} else if (platform == "xbox360") {
+			return cubemapFlag ? 0x36 : 0x16;	// (0x36 if cubemap)
+		}
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 32 && ddsPixelFormat.dwBBitMask == 0x00FF0000) {	// RGBA8888
+		if (platform == "pc") {
+			error = "Unsupported DDS pixel format for the PC version of the game.";
+			return 0;
+		} else if (platform == "ps3") {
+			return cubemapFlag ? 0x26 : 0x27;	// (0x26 if cubemap)
+		} else if (platform == "xbox360") {
+			return cubemapFlag ? 0x36 : 0x16;	// (0x36 if cubemap)
+		} else if (platform == "switch") {
+			return cubemapFlag ? 0x3F : 0x41;	// (0x3F if cubemap???)
+		}
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 64 && ddsPixelFormat.dwFourCC == 0x71) {	// A16B16G16R16F
+		return 0x2e;
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 16 && ddsPixelFormat.dwRBitMask == 0x00FF && ddsPixelFormat.dwABitMask == 0xFF00) {	// A8L8
+		if (platform == "pc") {
+			return 0x2f;
+		} else if (platform == "ps3") {
+			return 0x31;
+		} else if (platform == "xbox360") {
+			return 0x30;
+		}
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 16 && ddsPixelFormat.dwRBitMask == 0xF800) {	// R5G6B5
+		return 0x04;
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 16 && ddsPixelFormat.dwRBitMask == 0x0F00) {	// A4R4G4B4
+		return 0x05;
+	}
+	if (ddsPixelFormat.dwRGBBitCount == 8) {	// L8
+		return 0x37;
+	}
+
+	error = "Unsupported DDS pixel format.";
+	return 0;
+}
+
+// Function to get the swizzling applied by a TEX format
+SwizzleInfo getSwizzleInfo(DWORD texFormat) {
+	SwizzleInfo swizzle;
+
+	switch (texFormat) {
+	case 0x27:	// PS3 OK
+		swizzle.type = "morton";
+		swizzle.blockWidthHeight = 1;
+		break;
+	case 0x16:	// XBOX360
+		swizzle.type = "x360";
+		swizzle.blockPixelSize = 1;
+		swizzle.texelBytePitch = 4;
+		swizzle.convertToRGBA = true;
+		break;
+	case 0x3C:	// SWITCH
+	case 0x3D:	// SWITCH
+	case 0x3E:	// SWITCH
+	case 0x3F:	// SWITCH
+	case 0x40:	// SWITCH
+	case 0x41:	// SWITCH
+		swizzle.type = "switch";
+		swizzle.bytesPerBlock = 4;
+		swizzle.blockHeight = 16;
+		break;
+	case 0x28:	// XBOX360
+		swizzle.type = "x360";
+		swizzle.blockPixelSize = 4;
+		swizzle.texelBytePitch = 8;
+		break;
+	case 0x26:	// PS3
+	case 0x36:	// XBOX360
+	case 0x1b:	// XBOX360
+		swizzle.type = "morton";
+		swizzle.blockWidthHeight = 1;
+		break;
+	case 0x31:	// PS3
+		swizzle.type = "morton";
+		swizzle.blockWidthHeight = 1;
+		break;
+	case 0x30:	// XBOX360
+		swizzle.type = "x360";
+		swizzle.blockPixelSize = 1;
+		swizzle.texelBytePitch = 2;
+		break;
+	case 0x33:	// XBOX360
+		swizzle.type = "x360";
+		swizzle.blockPixelSize = 4;
+		swizzle.texelBytePitch = 16;
+		break;
+	}
+
+	return swizzle;
+}
+
+// Function to get the version of the game a TEX format belongs to: 'pc', 'ps3', 'xbox360' or 'switch', empty if unknown
+std::string getTexPlatform(DWORD texFormat) {
+	switch (texFormat) {
+	case 0x03:
+	case 0x04:
+	case 0x05:
+	case 0x17:
+	case 0x18:
+	case 0x2B:
+	case 0x2E:
+	case 0x2F:
+	case 0x32:
+	case 0x37:
+		return "pc";
+	case 0x26:
+	case 0x27:
+	case 0x2C:
+	case 0x31:
+	case 0x34:
+		return "ps3";
+	case 0x16:
+	case 0x1b:
+	case 0x28:
+	case 0x30:
+	case 0x33:
+	case 0x36:
+		return "xbox360";
+	case 0x3C:
+	case 0x3D:
+	case 0x3E:
+	case 0x3F:
+	case 0x40:
+	case 0x41:
+		return "switch";
+	default:
+		return "";
+	}
+}
+
+// Function to read the texture properties from the header of a TEX or DDS file, false if it is neither
+bool readTextureInfo(ByteSpan file, TextureInfo& info) {
+	info = TextureInfo();
+	if (checkFileSignature(file, "07000000") && file.size >= sizeof(TEX_Header)) {
+		TEX_Header texHeader;
+		std::memcpy(&texHeader, file.data, sizeof(TEX_Header));
+		info.container = "tex";
+		info.texFormat = texHeader.dwFormat;
+		info.platform = getTexPlatform(texHeader.dwFormat);
+		info.width = texHeader.dwWidth;
+		info.height = texHeader.dwHeight;
+		info.mipLevels = clampMipLevels(static_cast<uint64_t>(texHeader.dwMipCount) + 1, texHeader.dwWidth, texHeader.dwHeight);
+		return true;
+	}
+	if (validateDDSFile(file) && file.size >= sizeof(DWORD) + sizeof(DDS_HEADER)) {
+		DDS_HEADER ddsHeader;
+		std::memcpy(&ddsHeader, file.data + sizeof(DWORD), sizeof(DDS_HEADER));
+		info.container = "dds";
+		info.width = ddsHeader.dwWidth;
+		info.height = ddsHeader.dwHeight;
+		info.mipLevels = clampMipLevels(ddsHeader.dwMipMapCount, ddsHeader.dwWidth, ddsHeader.dwHeight);
+		return true;
+	}
+	return false;
+}
+
+// Function to get the sample rate of an OGG Vorbis file from the identification header on its first page, 0 if it can't be read
+uint32_t getOggSampleRate(ByteSpan input) {
+	const size_t pageHeaderSize = 27;	// Up to the segment table
+
+	// First page: "OggS", version, flags, granule position, serial number, sequence number, CRC, segments, segment table,
+	// then the identification packet: 0x01, "vorbis", version, channels, sample rate
+	if (input.size < pageHeaderSize || std::memcmp(input.data, "OggS", 4) != 0) {
+		return 0;
+	}
+	size_t packet = pageHeaderSize + input.data[26];
+	if (input.size < packet + 16 || std::memcmp(input.data + packet, "\x01vorbis", 7) != 0) {
+		return 0;
+	}
+	uint32_t sampleRate;
+	std::memcpy(&sampleRate, input.data + packet + 12, sizeof(sampleRate));
+	return sampleRate;
+}
+
+// Function to read the sound properties from the header of a SMP file, false if it isn't one
+// The SMP header doesn't hold the sample rate, so it is read from the start of the OGG file.
+bool readSmpInfo(ByteSpan file, SoundInfo& info) {
+	info = SoundInfo();
+	if (file.size < SMP_HEADER_SIZE + 4 || !checkFileSignature(ByteSpan{file.data + SMP_HEADER_SIZE, 4}, "4f676753")) {	// "OggS"
+		return false;
+	}
+
+	SMP_Header smpHeader;
+	std::memcpy(&smpHeader, file.data, sizeof(SMP_Header));
+	info.oggSize = smpHeader.dwOggSize;
+	info.sampleRate = getOggSampleRate(ByteSpan{file.data + SMP_HEADER_SIZE, file.size - SMP_HEADER_SIZE});
+	info.durationMs = smpHeader.dwDuration / 44 > 275 ? smpHeader.dwDuration / 44 - 275 : 0;
+	return true;
+}
+
+// Conversions running at the same time in this process, sharing the CPU cores between their kernels
+std::atomic<unsigned int> activeConversions(0);
+
+struct ActiveConversion {
+	ActiveConversion() { ++activeConversions; }
+	~ActiveConversion() { --activeConversions; }
+};
+
+// Function to get the number of threads the kernels of a conversion may use
+// Without an explicit count a conversion takes its share of the CPU cores, so a large texture converted
+// alone uses all of them while a busy batch keeps one thread per conversion.
+unsigned int kernelThreads(unsigned int requested) {
+	if (requested != 0) {
+		return requested;
+	}
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	return std::max(1u, cores / std::max(1u, activeConversions.load()));
+}
+
+// Function to reverse the bytes of every block of a Morton payload
+void reverseMortonBlocks(uint8_t* data, size_t size, int bytesPerBlock) {
+	if (bytesPerBlock <= 1) {
+		return;
+	}
+	if (16 % bytesPerBlock == 0) {
+		uint8_t reverseOrder[16];
+		build_reverse_order(reverseOrder, bytesPerBlock);
+		shuffle_bytes(data, data, size - size % bytesPerBlock, reverseOrder);
+	} else {
+		for (size_t i = 0; i + bytesPerBlock <= size; i += bytesPerBlock) {
+			std::reverse(data + i, data + i + bytesPerBlock);
+		}
+	}
+}
+
+// Function to check that a payload of <payloadSize> bytes holds every subresource of <layout>, in its
+// linear (DDS) or tiled (TEX) form, so that a corrupt header can't make the output larger than the input
+// The tiled form of the last subresource may stop at its linear size, as the original dds2tex wrote
+// Nintendo Switch surfaces no larger than their DDS payload; the missing blocks are read as zeros.
+bool layoutFits(const std::vector<Subresource>& layout, size_t payloadSize, bool linear) {
+	for (const Subresource& sub : layout) {
+		size_t offset = linear ? sub.linearOffset : sub.tiledOffset;
+		size_t size = linear ? sub.linearSize : sub.tiledSize;
+		if (!linear && &sub == &layout.back()) {
+			size = std::min(sub.tiledSize, sub.linearSize);
+		}
+		if (size > payloadSize || offset > payloadSize - size) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Function to check whether the kernel converting <sub> writes every byte of its output, so that the
+// output region doesn't need clearing first
+// Swizzling writes the whole tiled surface, padding included. Unswizzling leaves blocks untouched when
+// the Morton index bits don't span both sides (sides that aren't powers of two), or when an Xbox 360
+// surface isn't a whole number of the macro tiles a period fills (two side by side at 2 bytes per block).
+bool kernelCoversRegion(const Subresource& sub, const SwizzleInfo& swizzle, int bytesPerBlock, bool swizzling) {
+	if (swizzling) {
+		return true;
+	}
+
+	if (swizzle.type == "x360") {
+		size_t widthInBlocks = (sub.width + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize;
+		size_t heightInBlocks = (sub.height + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize;
+		size_t periodWidth = swizzle.texelBytePitch == 2 ? 64 : 32;
+		return widthInBlocks % periodWidth == 0 && heightInBlocks % 32 == 0;
+	} else if (swizzle.type == "morton") {
+		size_t blocksWide = sub.width / swizzle.blockWidthHeight;
+		size_t blocksHigh = sub.height / swizzle.blockWidthHeight;
+		size_t blockBytes = static_cast<size_t>(bytesPerBlock) * swizzle.blockWidthHeight * swizzle.blockWidthHeight;
+		bool powersOfTwo = (blocksWide & (blocksWide - 1)) == 0 && (blocksHigh & (blocksHigh - 1)) == 0;
+		return blocksWide > 0 && blocksHigh > 0 && powersOfTwo && blocksWide * blocksHigh * blockBytes == sub.linearSize;
+	} else if (swizzle.type == "switch") {
+		return static_cast<size_t>(sub.width) * swizzle.bytesPerBlock * sub.height == sub.linearSize;
+	}
+	return false;
+}
+
+// Destination of a conversion, filled region by region in file order
+class ConversionOutput {
+public:
+	virtual ~ConversionOutput() {}
+
+	virtual void reserve(size_t size) = 0;					// Size of the whole output, once known
+	virtual uint8_t* region(size_t size, bool zeroed) = 0;	// Buffer for the next <size> bytes of the output, cleared if <zeroed>
+	virtual bool commit() = 0;								// Appends the last region
+	virtual bool append(ByteSpan data) = 0;					// Appends a block of memory as it is
+};
+
+// Output held in memory as a whole
+// A reused vector (see BufferPool) is overwritten in place, and trimmed to the output once done.
+class VectorOutput : public ConversionOutput {
+public:
+	explicit VectorOutput(std::vector<uint8_t>& output) : output(output) {}
+	~VectorOutput() override { output.resize(used); }
+
+	void reserve(size_t size) override {
+		if (output.capacity() < size && used == 0) {
+			output.clear();	// Nothing worth copying on reallocation
+		}
+		output.reserve(size);
+	}
+	uint8_t* region(size_t size, bool zeroed) override {
+		size_t stale = output.size();
+		uint8_t* data = grow(size);
+		if (zeroed && used - size < stale) {
+			std::memset(data, 0, std::min(stale, used) - (used - size));	// Grown bytes are already cleared
+		}
+		return data;
+	}
+	bool commit() override { return true; }
+	bool append(ByteSpan data) override {
+		if (data.size > 0) {
+			std::memcpy(grow(data.size), data.data, data.size);
+		}
+		return true;
+	}
+
+private:
+	uint8_t* grow(size_t size) {
+		size_t offset = used;
+		used += size;
+		if (output.size() < used) {
+			output.resize(used);
+		}
+		return output.data() + offset;
+	}
+
+	std::vector<uint8_t>& output;
+	size_t used = 0;
+};
+
+// Output handed to a sink, holding a single region in memory at a time
+class SinkOutput : public ConversionOutput {
+public:
+	explicit SinkOutput(const OutputSink& sink) : sink(sink) {}
+
+	void reserve(size_t) override {}
+	uint8_t* region(size_t size, bool zeroed) override {
+		size_t stale = std::min(buffer.size(), size);
+		if (buffer.size() < size) {
+			buffer.resize(size);
+		}
+		if (zeroed) {
+			std::memset(buffer.data(), 0, stale);	// Grown bytes are already cleared
+		}
+		regionSize = size;
+		return buffer.data();
+	}
+	bool commit() override { return sink(ByteSpan{buffer.data(), regionSize}); }
+	bool append(ByteSpan data) override { return sink(data); }
+
+private:
+	const OutputSink& sink;
+	std::vector<uint8_t> buffer;
+	size_t regionSize = 0;
+};
+
+// Function to append the payload of a format without swizzling, a few MB at a time so that
+// streamed conversions release the input as they go
+bool appendPayload(ConversionOutput& output, const uint8_t* data, size_t size, size_t inputOffset, const std::function<void(size_t, size_t)>& releaseInput) {
+	const size_t chunkSize = 4 << 20;
+	for (size_t done = 0; done < size; done += chunkSize) {
+		size_t chunk = std::min(chunkSize, size - done);
+		if (!output.append(ByteSpan{data + done, chunk})) {
+			return false;
+		}
+		if (releaseInput) {
+			releaseInput(inputOffset + done, chunk);
+		}
+	}
+	return true;
+}
+
+// Function to convert a TEX file held in memory to DDS, region by region
+int convertTexToDds(ByteSpan input, ConversionOutput& output, const TexToDdsOptions& options, std::string& error) {
+	ActiveConversion active;
+
+	// Check if the file has a valid TEX header
+	if (!checkFileSignature(input, "07000000") || input.size < sizeof(TEX_Header)) {
+		error = "Not a valid TEX file!";
+		return 3;
+	}
+
+	// Read TEX header
+	TEX_Header texHeader;
+	std::memcpy(&texHeader, input.data, sizeof(TEX_Header));
+
+	const uint8_t* texData = input.data + sizeof(TEX_Header);
+	size_t fileSize = input.size - sizeof(TEX_Header);
+
+	// Populate DDS header
+	DDS_HEADER ddsHeader;
+	ddsHeader.dwHeight = texHeader.dwHeight;
+	ddsHeader.dwWidth = texHeader.dwWidth;
+
+	if (texHeader.dwMipCount > 0) {
+		ddsHeader.dwHeaderFlags |= DDS_HEADER_FLAGS_MIPMAP;
+		ddsHeader.dwMipMapCount = texHeader.dwMipCount + 1;
+		ddsHeader.dwSurfaceFlags |= DDS_SURFACE_FLAGS_MIPMAP;
+	}
+
+	switch (texHeader.dwFormat) {
+	case 0x03:	// PC
+	case 0x27:	// PS3
+		ddsHeader.ddspf = DDSPF_A8R8G8B8;
+		break;
+	case 0x16:	// XBOX360
+	case 0x41:	// SWITCH
+		ddsHeader.ddspf = DDSPF_R8G8B8A8;
+		ddsHeader.dwPitchOrLinearSize = texHeader.dwWidth * 4; // 4 bytes per pixel
+		break;
+	case 0x04:	// PC
+		ddsHeader.ddspf = DDSPF_R5G6B5;
+		break;
+	case 0x05:	// PC
+		ddsHeader.ddspf = DDSPF_A4R4G4B4;
+		break;
+	case 0x17:	// PC
+		ddsHeader.ddspf = DDSPF_DXT3;
+		break;
+	case 0x2B:	// PC
+	case 0x2C:	// PS3
+	case 0x28:	// XBOX360
+		ddsHeader.ddspf = DDSPF_DXT1;
+		break;
+	case 0x18:	// PC
+	case 0x26:	// PS3
+	case 0x36:	// XBOX360
+	case 0x1b:	// XBOX360
+		ddsHeader.ddspf = DDSPF_A8R8G8B8;
+		ddsHeader.dwSurfaceFlags |= DDS_SURFACE_FLAGS_CUBEMAP;
+		ddsHeader.dwCubemapFlags = DDS_CUBEMAP_ALLFACES;
+		break;
+	case 0x2E:
+		ddsHeader.ddspf = DDSPF_A16B16G16R16F;
+		break;
+	case 0x2F:	// PC
+	case 0x31:	// PS3
+	case 0x30:	// XBOX360
+		ddsHeader.ddspf = DDSPF_A8L8;
+		break;
+	case 0x32:	// PC
+	case 0x34:	// PS3
+	case 0x33:	// XBOX360
+		ddsHeader.ddspf = DDSPF_DXT5;
+		break;
+	case 0x37:	// PC
+		ddsHeader.ddspf = DDSPF_L8;
+		break;
+	case 0x40:	// SWITCH
+	case 0x3F:	// SWITCH
+	case 0x3D:	// SWITCH
+	case 0x3C:	// SWITCH
+	case 0x3E:	// SWITCH
+		error = "Unsupported Nintendo Switch TEX format: " + std::to_string(texHeader.dwFormat);
+		return 1;
+	default:
+		error = "Unsupported TEX format: " + std::to_string(texHeader.dwFormat);
+		return 1;
+	}
+
+	const SwizzleInfo swizzle = getSwizzleInfo(texHeader.dwFormat);
+	const size_t headerSize = sizeof(DWORD) + sizeof(DDS_HEADER);
+
+	// DDS header
+	uint8_t header[sizeof(DWORD) + sizeof(DDS_HEADER)];
+	std::memcpy(header, &DDS_MAGIC, sizeof(DWORD));
+	std::memcpy(header + sizeof(DWORD), &ddsHeader, sizeof(DDS_HEADER));
+
+	if (!swizzle.type.empty()) {
+		int blockPixelSizeDDS;
+		int bytesPerBlock;
+		getBlockInfo(ddsHeader.ddspf, blockPixelSizeDDS, bytesPerBlock);
+		int mipLevels = clampMipLevels(static_cast<uint64_t>(texHeader.dwMipCount) + 1, texHeader.dwWidth, texHeader.dwHeight);
+		int faces = ddsHeader.dwCubemapFlags ? 6 : 1;
+		std::vector<Subresource> layout = planSurfaceLayout(texHeader.dwWidth, texHeader.dwHeight, mipLevels, faces, blockPixelSizeDDS, bytesPerBlock, swizzle.type, swizzle.blockHeight);
+		if (layout.empty() || !layoutFits(layout, fileSize, false)) {
+			error = "Not a valid TEX file!";
+			return 3;
+		}
+
+		// The DDS header describes the mip levels actually converted
+		if (texHeader.dwMipCount > 0) {
+			ddsHeader.dwMipMapCount = mipLevels;
+			std::memcpy(header + sizeof(DWORD), &ddsHeader, sizeof(DDS_HEADER));
+		}
+
+		output.reserve(headerSize + layout.back().linearOffset + layout.back().linearSize);
+		if (!output.append(ByteSpan{header, headerSize})) {
+			return 1;
+		}
+
+		// Unswizzle every subresource with its own geometry, in the order of the DDS payload
+		const unsigned int threads = kernelThreads(options.threads);
+		for (const Subresource& sub : layout) {
+			const uint8_t* tiled = texData + sub.tiledOffset;
+			size_t tiledSize = std::min(sub.tiledSize, fileSize - sub.tiledOffset);
+			uint8_t* linear = output.region(sub.linearSize, tiledSize < sub.tiledSize || !kernelCoversRegion(sub, swizzle, bytesPerBlock, false));
+
+			StageTimer unswizzleTimer(options.stats, "unswizzle", "", tiledSize);
+			if (swizzle.type == "x360") {
+				int alignedWidth = (sub.width + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+				int alignedHeight = (sub.height + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+				unswizzle_x360(tiled, tiledSize, linear, sub.linearSize, alignedWidth, alignedHeight, swizzle.blockPixelSize, swizzle.texelBytePitch, swizzle.convertToRGBA ? X360_SWAP16_ARGB_TO_RGBA : X360_SWAP16, threads);
+			} else if (swizzle.type == "morton") {
+				unswizzle_morton(tiled, tiledSize, linear, sub.linearSize, sub.width, sub.height, bytesPerBlock, swizzle.blockWidthHeight, threads);
+			} else if (swizzle.type == "switch") {
+				unswizzle_switch(tiled, tiledSize, linear, sub.linearSize, sub.width, sub.height, swizzle.bytesPerBlock, sub.blockHeight, threads);
+			}
+			unswizzleTimer.stop();
+
+			if (swizzle.type == "morton") {
+				StageTimer reorderTimer(options.stats, "reorder", "", sub.linearSize);
+				reverseMortonBlocks(linear, sub.linearSize, bytesPerBlock);
+			}
+			if (options.releaseInput) {
+				options.releaseInput(sizeof(TEX_Header) + sub.tiledOffset, tiledSize);
+			}
+			if (!output.commit()) {
+				return 1;
+			}
+		}
+	} else {
+		// Formats without swizzling are copied as they are
+		StageTimer copyTimer(options.stats, "copy", "", fileSize);
+		output.reserve(headerSize + fileSize);
+		if (!output.append(ByteSpan{header, headerSize}) || !appendPayload(output, texData, fileSize, sizeof(TEX_Header), options.releaseInput)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Function to convert a TEX file held in memory to DDS
+int convertTexToDds(ByteSpan input, std::vector<uint8_t>& output, const TexToDdsOptions& options, std::string& error) {
+	VectorOutput target(output);
+	return convertTexToDds(input, target, options, error);
+}
+
+// Function to convert a TEX file held in memory to DDS, handing the DDS file to <sink> one subresource at a time
+int streamTexToDds(ByteSpan input, const OutputSink& sink, const TexToDdsOptions& options, std::string& error) {
+	SinkOutput target(sink);
+	int result = convertTexToDds(input, target, options, error);
+	if (result == 1 && error.empty()) {
+		error = "Unable to write the DDS file";
+	}
+	return result;
+}
+
+// Function to convert a DDS file held in memory to TEX, region by region
+int convertDdsToTex(ByteSpan input, ConversionOutput& output, const DdsToTexOptions& options, std::string& error) {
+	ActiveConversion active;
+
+	// Validate DDS file
+	if (!validateDDSFile(input) || input.size < sizeof(DWORD) + sizeof(DDS_HEADER)) {
+		error = "Not a valid DDS file!";
+		return 3;
+	}
+
+	// Read DDS header
+	DDS_HEADER ddsHeader;
+	std::memcpy(&ddsHeader, input.data + sizeof(DWORD), sizeof(DDS_HEADER));
+
+	// Check if the DDS file is a cubemap
+	bool isCubemap = (ddsHeader.dwCubemapFlags & 0x200) != 0;
+
+	// Map DDS format to TEX format
+	DWORD texFormat = mapDDSPixelFormatToTEX(ddsHeader.ddspf, isCubemap, options.platform, error);
+	if (texFormat == 0) {
+		error += " Conversion failed due to unsupported format.";
+		return 1;
+	}
+
+	// Check compression type (DXT1 or DXT5)
+	if (options.forceDxt1 && !options.forceDxt5 && texFormat != 43) {
+		error = "MUST USE DXT1 COMPRESSION!";
+		return 9;
+	} else if (!options.forceDxt1 && options.forceDxt5 && texFormat != 50) {
+		error = "MUST USE DXT5 COMPRESSION!";
+		return 7;
+	} else if (options.forceDxt1 && options.forceDxt5 && texFormat != 43 && texFormat != 50) {
+		error = "MUST USE DXT1 OR DXT5 COMPRESSION!";
+		return 5;
+	}
+
+	// Populate TEX header
+	TEX_Header texHeader;
+	texHeader.dwFormat = texFormat;
+	texHeader.dwWidth = ddsHeader.dwWidth;
+	texHeader.dwHeight = ddsHeader.dwHeight;
+	texHeader.dwMipCount = ddsHeader.dwMipMapCount > 0 ? ddsHeader.dwMipMapCount - 1 : 0;
+
+	const uint8_t* ddsData = input.data + sizeof(DWORD) + sizeof(DDS_HEADER);
+	size_t fileSize = input.size - sizeof(DWORD) - sizeof(DDS_HEADER);
+
+	const SwizzleInfo swizzle = getSwizzleInfo(texHeader.dwFormat);
+	const size_t headerSize = sizeof(TEX_Header);
+
+	// TEX header, signed over the start of the unused hash
+	const char signature[] = {0x4b, 0x65, 0x79, 0x6f, 0x66, 0x42, 0x6c, 0x75, 0x65, 0x53};
+	uint8_t header[sizeof(TEX_Header)];
+	std::memcpy(header, &texHeader, sizeof(TEX_Header));
+	std::memcpy(header + 4, signature, sizeof(signature));
+
+	if (!swizzle.type.empty()) {
+		int blockPixelSizeDDS;
+		int bytesPerBlock;
+		getBlockInfo(ddsHeader.ddspf, blockPixelSizeDDS, bytesPerBlock);
+		int mipLevels = clampMipLevels(ddsHeader.dwMipMapCount, texHeader.dwWidth, texHeader.dwHeight);
+		int faces = isCubemap ? 6 : 1;
+		std::vector<Subresource> layout = planSurfaceLayout(texHeader.dwWidth, texHeader.dwHeight, mipLevels, faces, blockPixelSizeDDS, bytesPerBlock, swizzle.type, swizzle.blockHeight);
+		if (layout.empty() || !layoutFits(layout, fileSize, true)) {
+			error = "Not a valid DDS file!";
+			return 3;
+		}
+
+		// The TEX header describes the mip levels actually converted
+		if (ddsHeader.dwMipMapCount > 0) {
+			texHeader.dwMipCount = mipLevels - 1;
+			std::memcpy(header, &texHeader, sizeof(TEX_Header));
+			std::memcpy(header + 4, signature, sizeof(signature));
+		}
+
+		output.reserve(headerSize + layout.back().tiledOffset + layout.back().tiledSize);
+		if (!output.append(ByteSpan{header, headerSize})) {
+			return 1;
+		}
+
+		// Swizzle every subresource with its own geometry, in the order of the TEX payload
+		const unsigned int threads = kernelThreads(options.threads);
+		for (const Subresource& sub : layout) {
+			uint8_t* tiled = output.region(sub.tiledSize, !kernelCoversRegion(sub, swizzle, bytesPerBlock, true));
+			const uint8_t* linear = ddsData + sub.linearOffset;
+
+			StageTimer swizzleTimer(options.stats, "swizzle", "", sub.linearSize);
+			if (swizzle.type == "x360") {
+				int alignedWidth = (sub.width + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+				int alignedHeight = (sub.height + swizzle.blockPixelSize - 1) / swizzle.blockPixelSize * swizzle.blockPixelSize;
+				swizzle_x360(linear, sub.linearSize, tiled, sub.tiledSize, alignedWidth, alignedHeight, swizzle.blockPixelSize, swizzle.texelBytePitch, swizzle.convertToRGBA ? X360_SWAP16_RGBA_TO_ARGB : X360_SWAP16, threads);
+			} else if (swizzle.type == "morton") {
+				swizzle_morton(linear, sub.linearSize, tiled, sub.tiledSize, sub.width, sub.height, bytesPerBlock, swizzle.blockWidthHeight, threads);
+			} else if (swizzle.type == "switch") {
+				swizzle_switch(linear, sub.linearSize, tiled, sub.tiledSize, sub.width, sub.height, swizzle.bytesPerBlock, sub.blockHeight, threads);
+			}
+			swizzleTimer.stop();
+
+			if (swizzle.type == "morton") {
+				StageTimer reorderTimer(options.stats, "reorder", "", sub.tiledSize);
+				reverseMortonBlocks(tiled, sub.tiledSize, bytesPerBlock);
+			}
+			if (options.releaseInput) {
+				options.releaseInput(sizeof(DWORD) + sizeof(DDS_HEADER) + sub.linearOffset, sub.linearSize);
+			}
+			if (!output.commit()) {
+				return 1;
+			}
+		}
+	} else {
+		// Formats without swizzling are copied as they are
+		StageTimer copyTimer(options.stats, "copy", "", fileSize);
+		output.reserve(headerSize + fileSize);
+		if (!output.append(ByteSpan{header, headerSize}) || !appendPayload(output, ddsData, fileSize, sizeof(DWORD) + sizeof(DDS_HEADER), options.releaseInput)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Function to convert a DDS file held in memory to TEX
+int convertDdsToTex(ByteSpan input, std::vector<uint8_t>& output, const DdsToTexOptions& options, std::string& error) {
+	VectorOutput target(output);
+	return convertDdsToTex(input, target, options, error);
+}
+
+// Function to convert a DDS file held in memory to TEX, handing the TEX file to <sink> one subresource at a time
+int streamDdsToTex(ByteSpan input, const OutputSink& sink, const DdsToTexOptions& options, std::string& error) {
+	SinkOutput target(sink);
+	int result = convertDdsToTex(input, target, options, error);
+	if (result == 1 && error.empty()) {
+		error = "Unable to write the TEX file";
+	}
+	return result;
+}
+
+}	// namespace gbtex
@@ -0,0 +1,636 @@
+/*  Ghostbusters The Video Game Texture Library
+	Copyright 2010 Jonathan Wilson
+	Copyright barncastle
+	Copyright 2025 KeyofBlueS - https://github.com/KeyofBlueS
+
+	The Ghostbusters The Video Game Texture Library is free software;
+	you can redistribute it and/or modify it under the terms of the
+	GNU General Public License as published by the Free Software Foundation;
+	either version 3, or (at your option) any later version.
+	See the file COPYING for more details.
+*/
+
+#ifndef GBTEX_H
+#define GBTEX_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <map>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <iosfwd>
+#include <cstdio>
+
+namespace gbtex {
+
+typedef uint32_t DWORD;
+typedef uint8_t BYTE;
+
+#define MAKEFOURCC(ch0, ch1, ch2, ch3) \
+	((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) | \
+	((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24 ))
+
+struct DDS_PIXELFORMAT {
+	DWORD dwSize;
+	DWORD dwFlags;
+	DWORD dwFourCC;
+	DWORD dwRGBBitCount;
+	DWORD dwRBitMask;
+	DWORD dwGBitMask;
+	DWORD dwBBitMask;
+	DWORD dwABitMask;
+};
+
+constexpr DWORD DDS_MAGIC = 0x20534444;	// DDS file magic number
+constexpr DWORD DDS_FOURCC = 0x00000004;
+constexpr DWORD DDS_RGB = 0x00000040;
+constexpr DWORD DDS_RGBA = 0x00000041;
+constexpr DWORD DDS_LUMINANCE = 0x00020000;
+constexpr DWORD DDS_LUMINANCEA = 0x00020001;
+constexpr DWORD DDS_PF_SIZE = sizeof(DDS_PIXELFORMAT);
+
+// Predefined DDS_PIXELFORMATs
+constexpr DDS_PIXELFORMAT DDSPF_DXT1 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','1'), 0, 0, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_DXT2 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','2'), 0, 0, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_DXT3 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','3'), 0, 0, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_DXT4 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','4'), 0, 0, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_DXT5 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','5'), 0, 0, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_A8R8G8B8 = { DDS_PF_SIZE, DDS_RGBA, 0, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 };
+constexpr DDS_PIXELFORMAT DDSPF_R8G8B8A8 = { DDS_PF_SIZE, DDS_RGBA, 0, 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 };
+constexpr DDS_PIXELFORMAT DDSPF_A1R5G5B5 = { DDS_PF_SIZE, DDS_RGBA, 0, 16, 0x00007C00, 0x000003E0, 0x0000001F, 0x00008000 };
+constexpr DDS_PIXELFORMAT DDSPF_A4R4G4B4 = { DDS_PF_SIZE, DDS_RGBA, 0, 16, 0x00000F00, 0x000000F0, 0x0000000F, 0x0000F000 };
+constexpr DDS_PIXELFORMAT DDSPF_R8G8B8 = { DDS_PF_SIZE, DDS_RGB, 0, 24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 };
+constexpr DDS_PIXELFORMAT DDSPF_R5G6B5 = { DDS_PF_SIZE, DDS_RGB, 0, 16, 0x0000F800, 0x000007E0, 0x0000001F, 0x00000000 };
+constexpr DDS_PIXELFORMAT DDSPF_A8L8 = { DDS_PF_SIZE, DDS_LUMINANCEA, 0, 16, 0xFF, 0, 0, 0xFF00 };
+constexpr DDS_PIXELFORMAT DDSPF_L8 = { DDS_PF_SIZE, DDS_LUMINANCE, 0, 8, 0xFF, 0, 0, 0 };
+constexpr DDS_PIXELFORMAT DDSPF_A16B16G16R16F = { DDS_PF_SIZE, DDS_FOURCC, 113, 0, 0, 0, 0, 0 };
+
+constexpr DWORD DDS_HEADER_FLAGS_TEXTURE =	0x00001007;	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT ;
+constexpr DWORD DDS_HEADER_FLAGS_MIPMAP =	0x00020000;	// DDSD_MIPMAPCOUNT;
+constexpr DWORD DDS_HEADER_FLAGS_VOLUME =	0x00800000;	// DDSD_DEPTH;
+constexpr DWORD DDS_HEADER_FLAGS_PITCH =	0x00000008;	// DDSD_PITCH;
+constexpr DWORD DDS_HEADER_FLAGS_LINEARSIZE = 0x00080000;	// DDSD_LINEARSIZE;
+constexpr DWORD DDS_SURFACE_FLAGS_TEXTURE =	0x00001000;	// DDSCAPS_TEXTURE
+constexpr DWORD DDS_SURFACE_FLAGS_MIPMAP =	0x00400008;	// DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+constexpr DWORD DDS_SURFACE_FLAGS_CUBEMAP =	0x00000008;	// DDSCAPS_COMPLEX
+constexpr DWORD DDS_CUBEMAP_POSITIVEX =		0x00000600;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+constexpr DWORD DDS_CUBEMAP_NEGATIVEX =		0x00000a00;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+constexpr DWORD DDS_CUBEMAP_POSITIVEY =		0x00001200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+constexpr DWORD DDS_CUBEMAP_NEGATIVEY =		0x00002200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+constexpr DWORD DDS_CUBEMAP_POSITIVEZ =		0x00004200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+constexpr DWORD DDS_CUBEMAP_NEGATIVEZ =		0x00008200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+constexpr DWORD DDS_FLAGS_VOLUME =			0x00200000;	// DDSCAPS2_VOLUME
+
+constexpr DWORD DDS_CUBEMAP_ALLFACES = DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX | \
+										DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY | \
+										DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ;
+
+struct DDS_HEADER
+{
+	DWORD dwSize = 124;
+	DWORD dwHeaderFlags = DDS_HEADER_FLAGS_TEXTURE;
+	DWORD dwHeight = 0;
+	DWORD dwWidth = 0;
+	DWORD dwPitchOrLinearSize = 0;
+	DWORD dwDepth = 0;	// only if DDS_HEADER_FLAGS_VOLUME is set in dwHeaderFlags
+	DWORD dwMipMapCount = 0;
+	DWORD dwReserved1[11] = {};
+	DDS_PIXELFORMAT ddspf = {};
+	DWORD dwSurfaceFlags = DDS_SURFACE_FLAGS_TEXTURE;
+	DWORD dwCubemapFlags = 0;
+	DWORD dwReserved2[3] = {};
+};
+
+struct TEX_Header
+{
+	DWORD dwVersion = 0x00000007;	// TEX magic number
+	BYTE bHash[16] = {};			// Placeholder, generally unused in our conversion
+	DWORD dwUnknown14 = 0;			// Placeholder
+	DWORD dwFormat = 0;				// TEX format derived from DDS format
+	DWORD dwWidth = 0;
+	DWORD dwHeight = 0;
+	DWORD dwUnknown24 = 0;			// Placeholder
+	DWORD dwMipCount = 0;
+	DWORD dwUnknown2C = 0;			// Placeholder
+	DWORD dwUnknown30 = 0;			// Placeholder
+};
+
+struct SMP_Header
+{
+	DWORD dwVersion = 0x00000006;	// SMP magic number
+	char signature[10] = {'K', 'e', 'y', 'o', 'f', 'B', 'l', 'u', 'e', 'S'};
+	BYTE bPadding0E[10] = {};
+	DWORD dwDuration = 0;			// (milliseconds + 275) * 44 (subtitle timing?)
+	DWORD dwUnknown1C = 0xa0;		// Placeholder
+	DWORD dwOggSize = 0;			// Size of the OGG file following the header
+	DWORD dwUnknown24 = 0x09;		// Placeholder
+	DWORD dwUnknown28 = 0;			// Placeholder
+	DWORD dwUnknown2C = 0x10;		// Placeholder
+	DWORD dwUnknown30 = 44100;		// Placeholder, 44100 whatever the sample rate of the OGG file (lip-sync animation?)
+	BYTE bPadding34[108] = {};
+};
+
+static_assert(sizeof(SMP_Header) == 160, "SMP_Header must match the 160 bytes of the SMP files");
+
+class ConversionStats;
+
+// Read-only view of a block of memory, such as a whole TEX or DDS file
+struct ByteSpan {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+// Options of a TEX to DDS conversion
+struct TexToDdsOptions {
+	unsigned int threads = 0;		// Threads used by the kernels on large surfaces, 0: the CPU cores left by other conversions
+	ConversionStats* stats = nullptr;	// Receives the time spent in every stage of the conversion, if set
+	std::function<void(size_t, size_t)> releaseInput;	// Called with the offset and size of every part of the input once converted, if set
+};
+
+// Options of a DDS to TEX conversion
+struct DdsToTexOptions {
+	std::string platform = "pc";	// 'pc', 'ps3', 'xbox360' or 'switch'
+	bool forceDxt1 = false;			// Fail unless the texture uses DXT1 compression
+	bool forceDxt5 = false;			// Fail unless the texture uses DXT5 compression
+	unsigned int threads = 0;		// Threads used by the kernels on large surfaces, 0: the CPU cores left by other conversions
+	ConversionStats* stats = nullptr;	// Receives the time spent in every stage of the conversion, if set
+	std::function<void(size_t, size_t)> releaseInput;	// Called with the offset and size of every part of the input once converted, if set
+};
+
+// Conversions between whole TEX and DDS files held in memory
+// They return 0 and fill <output> on success. On failure they return the exit code reported by
+// the command-line tools (1: unsupported texture, 3: invalid input, 5/7/9: compression mismatch)
+// and describe the problem in <error>. A swizzled texture whose header plans more surfaces than its
+// payload holds is an invalid input, so the output is never sized by an unchecked header.
+int convertTexToDds(ByteSpan input, std::vector<uint8_t>& output, const TexToDdsOptions& options, std::string& error);
+int convertDdsToTex(ByteSpan input, std::vector<uint8_t>& output, const DdsToTexOptions& options, std::string& error);
+
+// Streamed conversions, handing the output file to <sink> in order: the header, then one subresource
+// (a mip level of a face) at a time, so that only the largest subresource is held in memory.
+// They return 1 if <sink> returns false, with the same return codes otherwise.
+typedef std::function<bool(ByteSpan)> OutputSink;
+int streamTexToDds(ByteSpan input, const OutputSink& sink, const TexToDdsOptions& options, std::string& error);
+int streamDdsToTex(ByteSpan input, const OutputSink& sink, const DdsToTexOptions& options, std::string& error);
+
+// Conversions between whole SMP and OGG files held in memory, with the same return codes
+// They live in gbaudio.cpp, along with the helpers below.
+int convertSmpToOgg(ByteSpan input, std::vector<uint8_t>& output, std::string& error);
+int convertOggToSmp(ByteSpan input, std::vector<uint8_t>& output, std::string& error);
+
+// Function to get the duration of an OGG Vorbis file held in memory in milliseconds, -1 if it can't be read
+long long getOggDurationMilliseconds(ByteSpan input);
+
+// Function to fill the SMP header of an OGG file of <oggSize> bytes and <durationMilliseconds>
+SMP_Header makeSmpHeader(size_t oggSize, long long durationMilliseconds);
+
+// Swizzling applied by a TEX format
+struct SwizzleInfo {
+	std::string type;			// "morton", "x360" or "switch", empty for linear formats
+	int blockWidthHeight = 1;	// Morton: pixels per block side
+	int blockPixelSize = 1;		// Xbox 360: pixels per block side
+	int texelBytePitch = 4;		// Xbox 360: bytes per block
+	bool convertToRGBA = false;	// Xbox 360: ARGB in the TEX file, RGBA in the DDS file
+	int bytesPerBlock = 4;		// Nintendo Switch: bytes per block
+	int blockHeight = 8;		// Nintendo Switch: GOBs per block of the first mip level
+};
+
+SwizzleInfo getSwizzleInfo(DWORD texFormat);
+
+// Function to get the version of the game a TEX format belongs to: 'pc', 'ps3', 'xbox360' or 'switch', empty if unknown
+std::string getTexPlatform(DWORD texFormat);
+
+// Texture properties stored in the header of a TEX or DDS file
+struct TextureInfo {
+	std::string container;	// "tex" or "dds"
+	DWORD texFormat = 0;	// TEX format code, 0 for DDS files
+	std::string platform;	// Version of the game of the TEX format, empty for DDS files
+	DWORD width = 0;
+	DWORD height = 0;
+	DWORD mipLevels = 1;	// Mip levels including the full size one
+};
+
+// Function to read the texture properties from the header of a TEX or DDS file, false if it is neither
+// <file> only needs to hold the header (TEXTURE_HEADER_SIZE bytes covers both).
+bool readTextureInfo(ByteSpan file, TextureInfo& info);
+
+constexpr size_t TEXTURE_HEADER_SIZE = 128;	// DDS magic and header, longer than the TEX header
+constexpr size_t SMP_HEADER_SIZE = sizeof(SMP_Header);	// SMP header, followed by the OGG file
+constexpr size_t SMP_INFO_SIZE = SMP_HEADER_SIZE + 27 + 255 + 16;	// SMP header and OGG first page up to the sample rate
+
+// Sound properties stored in the header of a SMP file
+struct SoundInfo {
+	uint32_t oggSize = 0;		// Size of the OGG file following the header
+	uint32_t durationMs = 0;	// Duration, as written by ogg2smp: (milliseconds + 275) * 44
+	uint32_t sampleRate = 0;	// From the Vorbis identification header, 0 if it can't be read
+};
+
+// Function to read the sound properties from the header of a SMP file, false if it isn't one
+// <file> only needs to hold the header and the OGG signature after it, and SMP_INFO_SIZE bytes for the sample rate.
+bool readSmpInfo(ByteSpan file, SoundInfo& info);
+
+// Function to get the sample rate of an OGG Vorbis file from the identification header on its first page, 0 if it can't be read
+uint32_t getOggSampleRate(ByteSpan input);
+
+// Function to read the first <count> bytes of a file (fewer if the file is shorter) and its size, with a single read
+bool readFileHead(const std::string& filePath, size_t count, std::vector<uint8_t>& head, uint64_t& fileSize);
+
+// Function to map a DDS pixel format to the TEX format code of <platform>
+// Returns 0 and describes the problem in <error> if the format is unsupported.
+DWORD mapDDSPixelFormatToTEX(const DDS_PIXELFORMAT& ddsPixelFormat, DWORD cubemapFlag, const std::string& platform, std::string& error);
+
+// Layout of one subresource (a mip level of a cubemap face) inside the texture payload
+struct Subresource {
+	int face;
+	int mip;
+	int width;				// Mip level size in pixels
+	int height;
+	size_t pitch;			// Bytes per row of blocks in the linear (DDS) layout
+	size_t linearOffset;	// Offset inside the linear (DDS) payload
+	size_t linearSize;
+	size_t tiledOffset;		// Offset inside the swizzled (TEX) payload
+	size_t tiledSize;
+	int blockHeight;		// GOB block height of Nintendo Switch block-linear mip levels
+};
+
+void getBlockInfo(const DDS_PIXELFORMAT& ddspf, int& blockPixelSize, int& bytesPerBlock);
+// Function to get the mip levels of a <width> x <height> texture whose header claims <mipLevels>, clamped
+// between 1 and one level per halving of its longer side, so that a corrupt header can't plan a huge layout
+int clampMipLevels(uint64_t mipLevels, DWORD width, DWORD height);
+std::vector<Subresource> planSurfaceLayout(int width, int height, int mipLevels, int faces, int blockPixelSize, int bytesPerBlock, const std::string& swizzleType, int blockHeight);
+
+// Byte orders applied by the Xbox 360 kernels to every 16 bytes of linear data
+// Output byte i is taken from input byte X360_*[i].
+constexpr uint8_t X360_SWAP16[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };	// Big-endian 16-bit words
+constexpr uint8_t X360_SWAP16_ARGB_TO_RGBA[16] = { 1, 3, 2, 0, 5, 7, 6, 4, 9, 11, 10, 8, 13, 15, 14, 12 };	// Big-endian 16-bit words, alpha moved last
+constexpr uint8_t X360_SWAP16_RGBA_TO_ARGB[16] = { 3, 0, 2, 1, 7, 4, 6, 5, 11, 8, 10, 9, 15, 12, 14, 13 };	// Big-endian 16-bit words, alpha moved first
+
+// Surface kernels
+// Every kernel reads at most <input_size> bytes and writes at most <output_size> bytes of a single subresource.
+// Surfaces of a few MB or more are split into row bands converted by up to <threads> threads (0: one per CPU core),
+// with the same output whatever the number of threads.
+void shuffle_bytes(uint8_t* dst, const uint8_t* src, size_t size, const uint8_t* byte_order);
+void build_reverse_order(uint8_t byte_order[16], int texel_bytes);
+void unswizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order = X360_SWAP16, unsigned int threads = 1);
+void swizzle_x360(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int block_pixel_size, int texel_byte_pitch, const uint8_t* byte_order = X360_SWAP16, unsigned int threads = 1);
+void unswizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height = 1, unsigned int threads = 1);
+void swizzle_morton(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int width, int height, int bytes_per_pixel, int block_width_height = 1, unsigned int threads = 1);
+void unswizzle_switch(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int img_width, int img_height, int bytes_per_block, int block_height, unsigned int threads = 1);
+void swizzle_switch(const uint8_t* input, size_t input_size, uint8_t* output, size_t output_size, int img_width, int img_height, int bytes_per_block, int block_height, unsigned int threads = 1);
+
+// Read-only view of an input file, memory-mapped where the platform allows it
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& filePath);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return opened; }
+	const uint8_t* data() const { return bytes; }
+	size_t size() const { return length; }
+	ByteSpan span() const { return ByteSpan{bytes, length}; }
+
+	// Function to read the whole file ahead of its use, so that a slow disk is waited on by the calling thread
+	void prefetch() const;
+	// Function to drop the pages of a part of the file already used, read back from the disk if used again
+	void release(size_t offset, size_t size) const;
+
+private:
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+	bool opened = false;
+	bool mapped = false;
+	std::vector<uint8_t> buffer;	// Fallback storage where mmap is unavailable
+};
+
+// File helpers shared by the command-line tools
+bool checkFileSignature(ByteSpan file, const std::string& expectedSignature);
+bool validateDDSFile(ByteSpan file);
+bool writeFile(const std::string& filePath, const std::vector<uint8_t>& data);
+bool writeFile(const std::string& filePath, const std::vector<ByteSpan>& parts);
+bool copyFileTail(const std::string& inputFile, uint64_t offset, const std::string& outputFile, uint64_t& copied);
+
+// Output file written piece by piece, "-" for standard output
+// The file is created by the first write, so that a conversion failing before it leaves an existing file untouched.
+class OutputFile {
+public:
+	explicit OutputFile(const std::string& filePath) : path(filePath) {}
+	~OutputFile();
+
+	OutputFile(const OutputFile&) = delete;
+	OutputFile& operator=(const OutputFile&) = delete;
+
+	bool created() const { return opened; }
+	bool write(ByteSpan data);	// Creates the file and its directory on the first call
+	bool close();				// Returns false if any write failed
+	void discard();				// Closes the file and removes what was written of it
+
+private:
+	std::string path;
+	std::FILE* file = nullptr;
+	bool opened = false;
+	bool failed = false;
+};
+
+// Standard input and output, named "-" on the command line of the tools
+// writeFile() and copyFileTail() write to standard output when their output file is "-".
+bool isStandardStream(const std::string& filePath);
+bool readStandardInput(std::vector<uint8_t>& data, size_t count);
+bool copyStandardInput(ByteSpan head, const std::string& outputFile, uint64_t& copied);
+void createDirectories(const std::string& path);
+std::vector<std::string> collectBatchFiles(const std::string& batchSource, const std::string& extension);
+std::string batchOutputFile(const std::string& inputFile, const std::string& batchSource, const std::string& outputDir, const std::string& extension);
+
+// Pack file: many TEX or SMP files stored as a single file, to be memory-mapped as a whole
+// Layout: PACK_Header, the index (one PACK_Entry per file, sorted by name hash then name), the names
+// (UTF-8, not terminated), then the files, each starting on a PACK_ALIGNMENT boundary.
+constexpr DWORD PACK_MAGIC = MAKEFOURCC('G', 'B', 'P', 'K');
+constexpr DWORD PACK_VERSION = 1;
+constexpr DWORD PACK_KIND_TEX = MAKEFOURCC('T', 'E', 'X', ' ');
+constexpr DWORD PACK_KIND_SMP = MAKEFOURCC('S', 'M', 'P', ' ');
+constexpr size_t PACK_ALIGNMENT = 64;
+
+struct PACK_Header
+{
+	DWORD dwMagic = PACK_MAGIC;
+	DWORD dwVersion = PACK_VERSION;
+	DWORD dwKind = 0;				// PACK_KIND_TEX or PACK_KIND_SMP
+	DWORD dwEntryCount = 0;
+	uint64_t qwNamesOffset = 0;		// The index starts right after the header
+	uint64_t qwNamesSize = 0;
+	uint64_t qwDataOffset = 0;
+	uint64_t qwPackSize = 0;		// Size of the whole pack, to detect truncated files
+};
+
+struct PACK_Entry
+{
+	uint64_t qwNameHash = 0;		// hashBytes() of the name, low half
+	uint64_t qwOffset = 0;			// Offset of the file inside the pack
+	uint64_t qwSize = 0;
+	DWORD dwNameOffset = 0;			// Offset of the name inside the names
+	DWORD dwNameSize = 0;
+	DWORD dwFormat = 0;				// TEX: format code
+	DWORD dwWidth = 0;				// TEX: size of the full size mip level
+	DWORD dwHeight = 0;
+	DWORD dwMipCount = 0;			// TEX: mip levels including the full size one
+	DWORD dwDuration = 0;			// SMP: duration in milliseconds
+	DWORD dwSampleRate = 0;			// SMP: sample rate
+};
+
+static_assert(sizeof(PACK_Header) == 48, "PACK_Header must match the 48 bytes of the pack files");
+static_assert(sizeof(PACK_Entry) == 56, "PACK_Entry must match the 56 bytes of the pack index");
+
+// File to store in a pack: <entry> holds its size and properties, the pack fills in the rest
+struct PackInput {
+	std::string name;	// Name looked up by PackFile::find(), a path relative to the packed directory
+	std::string path;
+	PACK_Entry entry;
+};
+
+// Function to write a pack of <kind> holding every file of <inputs>, in a single sequential pass
+// The index and names are laid out from the sizes in <inputs> and written first, then the files follow.
+// The pack is written to a temporary file renamed over <packFile> once complete. Returns 0, or 1 (unreadable
+// input, unwritable pack) or 3 (duplicate names, input changed while packing) with a description in <error>.
+int writePack(const std::string& packFile, DWORD kind, std::vector<PackInput> inputs, std::string& error);
+
+// Function to get the name of the pack entry of a batch input: its path below <packSource>, or as listed
+// in a list file, with '/' separators
+std::string packEntryName(const std::string& inputFile, const std::string& packSource);
+
+// Function to check whether a file starts like a pack, telling packs from batch lists before validating them
+bool isPackFile(const std::string& filePath);
+
+// Read-only view of a pack file, memory-mapped where the platform allows it
+// Opening only checks the header. find() looks an entry up by name with a binary search of the index,
+// and entries are checked against the size of the pack as they are read.
+class PackFile {
+public:
+	explicit PackFile(const std::string& filePath);
+
+	bool is_open() const { return valid; }
+	DWORD kind() const { return header.dwKind; }
+	size_t entryCount() const { return header.dwEntryCount; }
+
+	bool find(const std::string& name, PACK_Entry& entry) const;
+	bool entry(size_t index, PACK_Entry& entry) const;	// Entries in index order
+	std::string entryName(const PACK_Entry& entry) const;
+	ByteSpan entryData(const PACK_Entry& entry) const;
+
+private:
+	MappedFile file;
+	PACK_Header header;
+	bool valid = false;
+};
+
+// 128-bit digest of a block of memory (MurmurHash3, x64 128-bit variant)
+struct Digest {
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	std::string hex() const;
+	bool operator==(const Digest& other) const { return low == other.low && high == other.high; }
+};
+
+Digest hashBytes(ByteSpan data, uint64_t seed = 0);
+
+// On-disk cache of converted files, addressed by the digest of their input and conversion options
+// Entries are plain files below <directory>; a hit refreshes the modification time of its entry, and
+// once the cache grows past <maxBytes> the least recently used entries are removed. Only successful
+// conversions are stored. A cache may be shared by the threads of a batch run.
+class ConversionCache {
+public:
+	ConversionCache(const std::string& directory, uint64_t maxBytes);
+
+	// Key of a conversion: <tool> names the converter and its version, <options> everything else changing the output
+	std::string key(ByteSpan input, const std::string& tool, const std::string& options) const;
+	std::string key(const Digest& input, const std::string& tool, const std::string& options) const;
+
+	bool load(const std::string& key, std::vector<uint8_t>& output);
+	void store(const std::string& key, const std::vector<uint8_t>& data);
+
+private:
+	std::string entryPath(const std::string& key) const;
+	void evict();
+
+	std::string directory;
+	uint64_t maxBytes;
+	uint64_t totalBytes = 0;
+	bool scanned = false;	// <totalBytes> is only known once the directory has been scanned
+	std::mutex mutex;
+};
+
+// Record of a batch run: the size, modification time and digest of every converted input, with its output
+// It is loaded before a batch and saved after it, so that later runs can skip unchanged inputs from a stat()
+// alone, or from their digest when only their metadata changed. Entries only count for runs with the same
+// <fingerprint> (tool, version and output options). A manifest may be shared by the threads of a batch run.
+class BatchManifest {
+public:
+	BatchManifest(const std::string& path, const std::string& fingerprint);
+
+	void load();
+	bool save();
+
+	// Functions to check an input against the previous run, carrying its entry over when it is unchanged
+	bool isUpToDate(const std::string& input, const std::string& output);
+	bool isUpToDate(const std::string& input, const std::string& output, const Digest& digest);
+
+	void record(const std::string& input, const std::string& output, const Digest& digest);
+
+private:
+	struct Entry {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		std::string digest;
+		std::string output;
+	};
+
+	std::string path;
+	std::string fingerprint;
+	std::map<std::string, Entry> previous;	// Entries of the previous run
+	std::map<std::string, Entry> current;	// Entries of this run
+	std::mutex mutex;
+};
+
+// Wall time, bytes and number of runs of every stage of the conversions of a run (--stats), and optionally
+// every single run of a stage (--trace), saved in the Chrome trace-event format (chrome://tracing, Perfetto).
+// Stages may be recorded from any thread. The whole conversion of a file, whose stages may run on different
+// threads, is recorded with recordFile() and shows up in the trace on a track of its own.
+class ConversionStats {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit ConversionStats(bool keepSpans);
+
+	void record(const std::string& stage, const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes);
+	void recordFile(const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes);
+	void printSummary(std::ostream& out) const;
+	bool saveTrace(const std::string& path) const;
+
+private:
+	struct Totals {
+		uint64_t count = 0;
+		Clock::duration time = Clock::duration::zero();
+		uint64_t bytes = 0;
+	};
+	struct Span {
+		std::string stage;
+		std::string file;
+		Clock::time_point start;
+		Clock::time_point end;
+		uint64_t bytes;
+		int thread;			// 0 for whole files
+	};
+
+	void add(const std::string& stage, const std::string& file, Clock::time_point start, Clock::time_point end, uint64_t bytes, bool wholeFile);
+
+	Clock::time_point started;
+	bool keepSpans;
+	std::vector<std::string> stageOrder;	// Stages in the order they first ran
+	std::map<std::string, Totals> totals;
+	std::vector<Span> spans;
+	std::map<std::thread::id, int> threads;	// Small thread numbers for the trace
+	mutable std::mutex mutex;
+};
+
+// Run of a stage, timed from its construction and recorded into <stats> (if any) when it goes out of scope
+class StageTimer {
+public:
+	StageTimer(ConversionStats* stats, const char* stage, const std::string& file = "", uint64_t bytes = 0)
+		: stats(stats), stage(stage), file(stats ? file : std::string()), bytes(bytes), start(ConversionStats::Clock::now()) {
+	}
+	~StageTimer() {
+		stop();
+	}
+
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+	void setBytes(uint64_t processed) { bytes = processed; }
+
+	// Ends the run before the timer goes out of scope
+	void stop() {
+		if (stats) {
+			stats->record(stage, file, start, ConversionStats::Clock::now(), bytes);
+			stats = nullptr;
+		}
+	}
+
+private:
+	ConversionStats* stats;
+	const char* stage;
+	std::string file;
+	uint64_t bytes;
+	ConversionStats::Clock::time_point start;
+};
+
+// Function to quote a string for JSON output
+std::string jsonString(const std::string& text);
+
+// Outcome of the conversion of one file, printed by the tools as a line of JSON in --json mode
+struct FileReport {
+	std::string input;
+	std::string output;
+	std::string status = "converted";	// "converted", "cached", "unchanged" or "failed"
+	TextureInfo texture;			// Texture tools only, left empty when the header couldn't be read
+	uint64_t inputBytes = 0;
+	uint64_t outputBytes = 0;
+	double seconds = 0;				// Elapsed time from the start of the conversion to the end of the write
+	int exitCode = 0;
+	std::string errorClass;			// See conversionErrorClass(), "io" for unreadable or unwritable files, "exception" otherwise
+	std::string error;
+};
+
+// Function to get the error class of an exit code returned by a conversion, empty on success
+std::string conversionErrorClass(int exitCode);
+
+// Function to fail a report with <errorClass> and <error>, returning <exitCode>
+int failReport(FileReport* report, int exitCode, const std::string& errorClass, const std::string& error);
+
+// Function to print a report as a single line of JSON, atomically with respect to other threads
+void printFileReport(std::ostream& out, const FileReport& report);
+
+// Function to run the conversion of <input> to <output>, reporting its exceptions as failed conversions
+// The report filled by <convert> is timed and, if <json> is set, printed to std::cout.
+int runReportedConversion(const std::string& input, const std::string& output, bool json, const std::function<int(FileReport&)>& convert);
+
+// Function to run <convert> for every index below <count>, spreading the work across <jobs> threads
+// (0: one per CPU core). Returns the result of every call, in index order.
+std::vector<int> runBatchJobs(size_t count, unsigned int jobs, const std::function<int(size_t)>& convert);
+
+// Stage result ending a batch entry early without an error (e.g. an input unchanged since the last run)
+constexpr int BATCH_SKIP = -1;
+
+// Function to run a batch as three overlapping stages: <read> on one thread, <convert> on <jobs> threads
+// (0: one per CPU core) and <write> on one thread, so that disk I/O and conversions of different entries
+// run at the same time. Each stage is called with the index of an entry, and a non-zero result ends that
+// entry. At most <depth> entries (0: twice the number of jobs) wait between two stages, bounding the
+// memory held by entries in flight. Returns the result of every entry, in index order.
+std::vector<int> runBatchPipeline(size_t count, unsigned int jobs, size_t depth, const std::function<int(size_t)>& read, const std::function<int(size_t)>& convert, const std::function<int(size_t)>& write);
+
+// Pool of output buffers reused from one conversion to the next
+// A buffer given back keeps its memory and its contents, so that once the buffers of a batch or a server
+// have grown to the largest files they hold, conversions neither allocate nor clear fresh pages: the
+// converters overwrite a reused buffer and trim it to their output. The buffers kept hold at most
+// <maxBytes> together; any other buffer given back is freed. A pool may be shared by threads.
+class BufferPool {
+public:
+	explicit BufferPool(size_t maxBytes = 256 << 20) : maxBytes(maxBytes) {}
+
+	std::vector<uint8_t> acquire();					// Buffer of an earlier conversion, or an empty one; its contents are stale
+	void release(std::vector<uint8_t>& buffer);		// Takes <buffer> back, leaving it empty
+
+private:
+	std::mutex mutex;
+	std::vector<std::vector<uint8_t>> buffers;
+	size_t maxBytes;
+	size_t retainedBytes = 0;	// Capacity of the buffers kept
+};
+
+}	// namespace gbtex
+
+#endif	// GBTEX_H
@@ -9,165 +9,188 @@
 */
 
 #include <iostream>
-#include <fstream>
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
+#include <cstdint>
 #include <filesystem>
-#include <vorbis/codec.h>
-#include <vorbis/vorbisfile.h>
 #include <algorithm>
 #include <getopt.h>
+#include <vector>
+#include <atomic>
+#include <memory>
 
+#include "../libgbtex/gbtex.h"
+
+const std::string version = "v0.2.0";
 bool quiet = false;	// Quiet mode flag
+bool json = false;	// JSON report mode flag
+std::unique_ptr<gbtex::ConversionStats> stats;	// Stage timings, if --stats or --trace is used
 
-// Function to get the file size
-std::streamsize getFileSize(const std::string& filename) {
-	std::ifstream file(filename, std::ios::binary | std::ios::ate);
-	return file.tellg();
+// Function to print the help message
+void printHelpMessage() {
+	std::cout << std::endl;
+	std::cout << "👻 GBTVGR OGG to SMP Converter " << version << std::endl;
+	std::cout << std::endl;
+	std::cout << "Usage: ogg2smp <input_file.ogg> [options]" << std::endl;
+	std::cout << "       ogg2smp --batch <input_dir|list.txt> [options]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -i, --input <input_file.dds>		Specify the input OGG file path and name. '-' reads it from standard input." << std::endl;
+	std::cout << "  -o, --output <output_file.smp>	Specify the output SMP file path and name. '-' writes it to standard output." << std::endl;
+	std::cout << "					In batch mode, specify the output directory." << std::endl;
+	std::cout << "  -b, --batch <input_dir|list.txt>	Convert every OGG file below <input_dir>, or every file listed in <list.txt>." << std::endl;
+	std::cout << "  -j, --jobs <n>			Number of worker threads used in batch mode. Default is the number of CPU cores." << std::endl;
+	std::cout << "  -m, --manifest <manifest.txt>		In batch mode, skip the OGG files unchanged since the run that wrote <manifest.txt>, then update it." << std::endl;
+	std::cout << "  -s, --stats				Print the time spent in every stage of the conversions on exit." << std::endl;
+	std::cout << "  -t, --trace <trace.json>		Save the stages of every conversion to <trace.json>, in Chrome trace-event format." << std::endl;
+	std::cout << "  -J, --json				Print a line of JSON describing every converted file instead of the output messages." << std::endl;
+	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
+	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
+	std::cout << std::endl;
+	std::cout << std::endl;
+	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
+	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
+	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
+	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
 }
 
-// Function to convert integer to hex string
-std::string intToHex(uint32_t num) {
-	std::stringstream ss;
-	ss << std::hex << std::setw(8) << std::setfill('0') << num;
-	return ss.str();
-}
+// Function to convert a single OGG file to SMP
+// The OGG file is opened once and written after the SMP header with a single write. From standard input
+// it is read whole, as the header needs its size and duration.
+// In an incremental batch run, OGG files whose content didn't change since the last run are skipped.
+int convertFile(const std::string& inputFile, const std::string& outputFile, gbtex::BatchManifest* manifest, gbtex::FileReport& report) {
+	gbtex::ConversionStats::Clock::time_point started = gbtex::ConversionStats::Clock::now();
 
-// Function to reverse byte order in the hex string
-std::string reverseBytes(const std::string& hex) {
-	std::string reversed;
-	for (int i = hex.length(); i > 0; i -= 2) {
-		reversed += hex.substr(i - 2, 2);
-	}
-	return reversed;
-}
+	//setConsoleTitleAndPrint("👻 GBTVGR Converter", "👻 GBTVGR OGG to SMP Converter v0.0.1:");
 
-// Function to convert a hexadecimal string into a string of bytes.
-std::string hexToByteString(const std::string& hex) {
-	std::string bytes;
-	for (size_t i = 0; i < hex.length(); i += 2) {
-		std::string byteString = hex.substr(i, 2);
-		char byte = (char) strtol(byteString.c_str(), nullptr, 16);
-		bytes += byte;
+	// Map OGG file, or read it from standard input
+	gbtex::StageTimer readTimer(stats.get(), "read", inputFile);
+	std::unique_ptr<gbtex::MappedFile> oggFile;
+	std::vector<uint8_t> oggBuffer;
+	gbtex::ByteSpan oggData;
+	if (gbtex::isStandardStream(inputFile)) {
+		if (!gbtex::readStandardInput(oggBuffer, SIZE_MAX)) {
+			std::cerr << "* ERROR: Unable to read standard input" << std::endl;
+			return gbtex::failReport(&report, 1, "io", "Unable to read standard input");
+		}
+		oggData = gbtex::ByteSpan{oggBuffer.data(), oggBuffer.size()};
+	} else {
+		oggFile.reset(new gbtex::MappedFile(inputFile));
+		if (!oggFile->is_open()) {
+			std::cerr << "* ERROR: Unable to open file: " << inputFile << std::endl;
+			return gbtex::failReport(&report, 3, "io", "Unable to open file: " + inputFile);
+		}
+		oggData = oggFile->span();
 	}
-	return bytes;
-}
-
-// Function to add padding to hexdata for writing
-void addPadding(std::ofstream& outFile, int count) {
-	for (int i = 0; i < count; ++i) {
-		outFile.put(0x00);	// Add zero bytes
+	readTimer.setBytes(oggData.size);
+	readTimer.stop();
+	report.inputBytes = oggData.size;
+
+	// Skip the OGG file if its content didn't change since the last run
+	gbtex::Digest inputDigest;
+	if (manifest) {
+		gbtex::StageTimer hashTimer(stats.get(), "hash", inputFile, oggData.size);
+		inputDigest = gbtex::hashBytes(oggData);
+		if (manifest->isUpToDate(inputFile, outputFile, inputDigest)) {
+			report.status = "unchanged";
+			return 0;
+		}
 	}
-}
 
-// Function to get the duration of an Ogg file in milliseconds
-long long getOggFileDurationMilliseconds(const char* filename) {
-	OggVorbis_File vf;
-	FILE* file = fopen(filename, "rb");
-	
-	if (!file) {
-		std::cerr << "Error opening file: " << filename << std::endl;
-		return -1;
+	// Check if the file has a valid OGG header
+	if (oggData.size < 3 || std::memcmp(oggData.data, "Ogg", 3) != 0) {
+		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid OGG!" << std::endl;
+		return gbtex::failReport(&report, 3, gbtex::conversionErrorClass(3), "Not a valid OGG file!");
 	}
 
-	if (ov_open(file, &vf, NULL, 0) < 0) {
-		std::cerr << "Error reading Ogg file: " << filename << std::endl;
-		fclose(file); 	// Ensure file is closed if opening fails
-		return -1;
+	// Get duration in milliseconds from the last Ogg page
+	gbtex::StageTimer durationTimer(stats.get(), "duration", inputFile, oggData.size);
+	long long duration_millis = gbtex::getOggDurationMilliseconds(oggData);
+	if (duration_millis < 0) {
+		std::cerr << "* ERROR: Unable to read the duration of: " << inputFile << std::endl;
 	}
+	durationTimer.stop();
 
-	// Get the total number of samples in the file
-	long totalSamples = ov_pcm_total(&vf, -1);
-
-	// Get the sample rate of the first stream
-	long sampleRate = ov_info(&vf, -1)->rate;
+	// Prepare the 160 bytes header
+	gbtex::SMP_Header smpHeader = gbtex::makeSmpHeader(oggData.size, duration_millis);
 
-	// Clean up the OggVorbis_File structure
-	ov_clear(&vf);
+	// Create output directory if not exists
+	gbtex::createDirectories(std::filesystem::path(outputFile).parent_path().string());
 
-	// Convert total samples to milliseconds
-	long long duration_millis = (totalSamples * 1000) / sampleRate;
+	// Write the header followed by the input OGG file
+	uint64_t written = gbtex::SMP_HEADER_SIZE + oggData.size;
+	gbtex::StageTimer writeTimer(stats.get(), "write", inputFile, written);
+	if (!gbtex::writeFile(outputFile, {gbtex::ByteSpan{reinterpret_cast<const uint8_t*>(&smpHeader), sizeof(smpHeader)}, oggData})) {
+		std::cerr << "* ERROR: Unable to open output file: " << outputFile << std::endl;
+		return gbtex::failReport(&report, 1, "io", "Unable to open output file: " + outputFile);
+	}
+	writeTimer.stop();
 
-	return duration_millis;
-}
+	if (stats) {
+		stats->recordFile(inputFile, started, gbtex::ConversionStats::Clock::now(), oggData.size);
+	}
+	report.outputBytes = written;
 
-// Function to add padding
-std::string processDuration(long long duration_millis) {
-	// Add 275 ms
-	duration_millis += 275;
-
-	// Multiply by 44
-	long long durationScaled = duration_millis * 44;
-
-	// Convert to hex
-
-	std::string duration_hex = intToHex(static_cast<uint32_t>(durationScaled));
-
-	// Add padding to the hex string
-	int hexSize = duration_hex.size();
-	std::string durationHexPadded;
-
-	if (hexSize == 1) {
-		duration_hex = "000" + duration_hex + "00";
-	} else if (hexSize == 2) {
-		duration_hex = "00" + duration_hex + "00";
-	} else if (hexSize == 3) {
-		duration_hex = "0" + duration_hex + "00";
-	} else if (hexSize == 4) {
-		duration_hex = duration_hex + "00";
-	} else if (hexSize == 5) {
-		duration_hex = "0" + duration_hex;
-	} else if (hexSize == 6) {
-		duration_hex = duration_hex;
+	if (manifest) {
+		manifest->record(inputFile, outputFile, inputDigest);
 	}
 
-	return duration_hex;
+	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
+
+	return 0;
 }
 
-// Function to validate the input file
-bool checkFileSignature(const std::string& filePath, const std::string& expectedSignature) {
-	std::ifstream file(filePath, std::ios::binary);
-	if (!file.is_open()) {
-		std::cerr << "* ERROR: Unable to open file: " << filePath << std::endl;
-		return false;
+// Function to convert every file of a batch, spreading the work across <jobs> threads
+// With a manifest, files unchanged since the run that wrote it are skipped.
+int runBatch(const std::string& batchSource, const std::string& outputDir, unsigned int jobs, const std::string& manifestFile) {
+	std::vector<std::string> files = gbtex::collectBatchFiles(batchSource, ".ogg");
+	if (files.empty()) {
+		std::cerr << "* ERROR: No OGG files found in: " << batchSource << std::endl;
+		return 1;
 	}
 
-	char buffer[3];
-	file.read(buffer, 3);
-	file.close();
-
-	std::stringstream hexStream;
-	for (int i = 0; i < 3; ++i) {
-		hexStream << std::hex << std::setw(2) << std::setfill('0') << (int)(unsigned char)buffer[i];
+	std::unique_ptr<gbtex::BatchManifest> manifest;
+	if (!manifestFile.empty()) {
+		manifest.reset(new gbtex::BatchManifest(manifestFile, "ogg2smp " + version));
+		manifest->load();
 	}
 
-	return hexStream.str() == expectedSignature;
-}
-
-// Function to create output directory
-void createDirectories(const std::string& path) {
-	std::filesystem::create_directories(path);
-}
+	std::atomic<size_t> unchanged(0);
+	std::vector<int> results = gbtex::runBatchJobs(files.size(), jobs, [&](size_t i) {
+		std::string outputFile = gbtex::batchOutputFile(files[i], batchSource, outputDir, ".smp");
+		return gbtex::runReportedConversion(files[i], outputFile, json, [&](gbtex::FileReport& report) {
+			int result = 0;
+			if (manifest && manifest->isUpToDate(files[i], outputFile)) {
+				report.status = "unchanged";
+			} else {
+				result = convertFile(files[i], outputFile, manifest.get(), report);
+			}
+
+			// Inputs skipped on their digest are unchanged as well
+			if (report.status == "unchanged") {
+				++unchanged;
+			}
+			return result;
+		});
+	});
+
+	if (manifest && !manifest->save()) {
+		std::cerr << "* ERROR: Unable to write manifest: " << manifestFile << std::endl;
+	}
 
-// Function to print the help message
-void printHelpMessage() {
-	std::cout << std::endl;
-	std::cout << "👻 GBTVGR OGG to SMP Converter v0.2.0" << std::endl;
-	std::cout << std::endl;
-	std::cout << "Usage: ogg2smp <input_file.ogg> [options]" << std::endl;
-	std::cout << std::endl;
-	std::cout << "Options:" << std::endl;
-	std::cout << "  -i, --input <input_file.dds>		Specify the input OGG file path and name." << std::endl;
-	std::cout << "  -o, --output <output_file.smp>	Specify the output SMP file path and name." << std::endl;
-	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
-	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
-	std::cout << std::endl;
-	std::cout << std::endl;
-	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
-	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
-	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
-	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
+	// Report the exit code of the first failed conversion
+	size_t failed = std::count_if(results.begin(), results.end(), [](int result) { return result != 0; });
+	if (!quiet) {
+		std::cout << "Batch complete: " << files.size() - failed - unchanged << " of " << files.size() << " files converted";
+		if (manifest) std::cout << ", " << unchanged << " unchanged";
+		std::cout << "." << std::endl;
+	}
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
+	}
+	return 0;
 }
 
 // Main function
@@ -175,12 +198,23 @@ int main(int argc, char* argv[]) {
 
 	std::string inputFile;
 	std::string outputFile;
+	std::string batchSource;
+	unsigned int jobs = 0;
+	std::string manifestFile;
+	bool printStats = false;
+	std::string traceFile;
 	bool argError = false;
 
 	// Define the long options for getopt
 	struct option long_options[] = {
 		{"input", required_argument, nullptr, 'i'},
 		{"output", required_argument, nullptr, 'o'},
+		{"batch", required_argument, nullptr, 'b'},
+		{"jobs", required_argument, nullptr, 'j'},
+		{"manifest", required_argument, nullptr, 'm'},
+		{"stats", no_argument, nullptr, 's'},
+		{"trace", required_argument, nullptr, 't'},
+		{"json", no_argument, nullptr, 'J'},
 		{"quiet", no_argument, nullptr, 'q'},
 		{"help", no_argument, nullptr, 'h'},
 		{nullptr, 0, nullptr, 0}	// Terminate the list of options
@@ -189,7 +223,7 @@ int main(int argc, char* argv[]) {
 	// Parse command-line arguments
 	int opt;
 	int option_index = 0;
-	while ((opt = getopt_long(argc, argv, "i:o:qh", long_options, &option_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "i:o:b:j:m:st:Jqh", long_options, &option_index)) != -1) {
 		switch (opt) {
 			case 'i':
 				inputFile = optarg;
@@ -197,6 +231,30 @@ int main(int argc, char* argv[]) {
 			case 'o':
 				outputFile = optarg;
 				break;
+			case 'b':
+				batchSource = optarg;
+				break;
+			case 'j':
+				try {
+					jobs = static_cast<unsigned int>(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid number of jobs: " << optarg << std::endl;
+				}
+				break;
+			case 'm':
+				manifestFile = optarg;
+				break;
+			case 's':
+				printStats = true;
+				break;
+			case 't':
+				traceFile = optarg;
+				break;
+			case 'J':
+				json = true;
+				quiet = true;
+				break;
 			case 'q':
 				quiet = true;
 				break;
@@ -212,11 +270,11 @@ int main(int argc, char* argv[]) {
 	// Remaining arguments (positional)
 	for (int i = optind; i < argc; ++i) {
 		std::string arg = argv[i];
-		if (arg.rfind("-", 0) == 0) {
+		if (arg.rfind("-", 0) == 0 && arg != "-") {
 			argError = true;
 			return 1;
 		}
-		if (inputFile.empty()) {
+		if (inputFile.empty() && batchSource.empty()) {
 			inputFile = arg;
 		} else {
 			argError = true;
@@ -225,9 +283,30 @@ int main(int argc, char* argv[]) {
 	}
 
 	// Check if input file is provided
-	if (inputFile.empty()) {
+	if (inputFile.empty() && batchSource.empty()) {
 		argError = true;
 		std::cerr << "* ERROR: No input file specified." << std::endl;
+	} else if (!inputFile.empty() && !batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: An input file can't be combined with batch mode." << std::endl;
+	} else if (!manifestFile.empty() && batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: A manifest can only be used in batch mode." << std::endl;
+	}
+
+	// Standard output carries the converted file, so it takes neither messages nor JSON reports
+	if (outputFile.empty() && gbtex::isStandardStream(inputFile)) {
+		outputFile = inputFile;
+	}
+	if (gbtex::isStandardStream(outputFile)) {
+		if (!batchSource.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Only a single file can be written to standard output." << std::endl;
+		} else if (json) {
+			argError = true;
+			std::cerr << "* ERROR: JSON output can't be combined with writing to standard output." << std::endl;
+		}
+		quiet = true;
 	}
 
 	if (argError) {
@@ -235,84 +314,29 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	// Generate default output file if not provided
-	if (outputFile.empty()) {
-		outputFile = std::filesystem::path(inputFile).replace_extension(".smp").string();
+	if (printStats || !traceFile.empty()) {
+		stats.reset(new gbtex::ConversionStats(!traceFile.empty()));
 	}
 
-	std::string pathTo = std::filesystem::path(outputFile).parent_path().string();
-	std::string file = std::filesystem::path(outputFile).stem().string();
-
-	std::string input = "ogg";
-	std::string output = "smp";
-
-	//setConsoleTitleAndPrint("👻 GBTVGR Converter", "👻 GBTVGR OGG to SMP Converter v0.0.1:");
+	int result;
+	if (!batchSource.empty()) {
+		result = runBatch(batchSource, outputFile, jobs, manifestFile);
+	} else {
+		// Generate default output file if not provided
+		if (outputFile.empty()) {
+			outputFile = std::filesystem::path(inputFile).replace_extension(".smp").string();
+		}
 
-	// Check if the file has a valid OGG header
-	if (!checkFileSignature(inputFile, "4f6767")) {
-		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid OGG!" << std::endl;
-		return 3;
+		result = gbtex::runReportedConversion(inputFile, outputFile, json, [&](gbtex::FileReport& report) {
+			return convertFile(inputFile, outputFile, nullptr, report);
+		});
 	}
 
-	// Get file size in bytes, convert to hex and reverse the bytes
-	std::streamsize dimension_bytes = getFileSize(inputFile);
-	std::string dimension_hex = intToHex(static_cast<uint32_t>(dimension_bytes));
-	std::string dimension_hex_rev = reverseBytes(dimension_hex);
-
-	// Get duration in milliseconds, convert to hex and reverse the bytes
-	long long duration_millis = getOggFileDurationMilliseconds(inputFile.c_str());
-	std::string duration_hex = processDuration(duration_millis);
-	std::string duration_hex_rev = reverseBytes(duration_hex);
-	duration_hex_rev += "00";
-	
-	// Create output directory if not exists
-	createDirectories(pathTo);
-
-	// Prepare output file
-	std::ofstream outFile(outputFile, std::ios::binary);
-	if (!outFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open output file: " << outputFile << std::endl;
-		return 1;
+	if (printStats) {
+		stats->printSummary(json || gbtex::isStandardStream(outputFile) ? std::cerr : std::cout);
 	}
-
-	// Prepare and write the 160 bytes header
-	outFile.put(0x06);			// byte 0
-	addPadding(outFile, 3);		// bytes from 1 to 3
-	outFile.put(0x4b);			// byte 4
-	outFile.put(0x65);			// byte 5
-	outFile.put(0x79);			// byte 6
-	outFile.put(0x6f);			// byte 7
-	outFile.put(0x66);			// byte 8
-	outFile.put(0x42);			// byte 9
-	outFile.put(0x6c);			// byte 10
-	outFile.put(0x75);			// byte 11
-	outFile.put(0x65);			// byte 12
-	outFile.put(0x53);			// byte 13
-	addPadding(outFile, 10);	// bytes from 14 to 23
-	outFile.write(hexToByteString(duration_hex_rev).c_str(), 4);	// bytes from 24 to 27 (subtitle timing?)
-	outFile.put(0xa0);			// byte 28
-	addPadding(outFile, 3);		// bytes from 29 to 31
-	outFile.write(hexToByteString(dimension_hex_rev).c_str(), 4);	// bytes from 32 to 35 (.ogg file size in bytes)
-	outFile.put(0x09);			// byte 36
-	addPadding(outFile, 7);		// bytes from 37 to 43 (byte 40???)
-	outFile.put(0x10);			// byte 44
-	addPadding(outFile, 3);		// bytes from 45 to 47 byte
-	outFile.put(0x44);			// byte 48 (lip-sync animation?)
-	outFile.put(0xac);			// byte 49 (lip-sync animation?)
-	addPadding(outFile, 110);	// bytes from 50 to 160
-
-	// Append the input OGG file
-	std::ifstream inFile(inputFile, std::ios::binary);
-	if (!inFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open input file: " << inputFile << std::endl;
-		return 1;
+	if (!traceFile.empty() && !stats->saveTrace(traceFile)) {
+		std::cerr << "* ERROR: Unable to write trace: " << traceFile << std::endl;
 	}
-	outFile << inFile.rdbuf();
-
-	outFile.close();
-	inFile.close();
-
-	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
-
-	return 0;
+	return result;
 }
@@ -11,49 +11,47 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
+#include <cstdint>
 #include <filesystem>
+#include <algorithm>
 #include <getopt.h>
+#include <vector>
+#include <atomic>
+#include <memory>
 
-bool quiet = false;	// Quiet mode flag
-
-// Function to validate the input file
-bool checkFileSignature(const std::string& filePath, const std::string& expectedSignature) {
-	std::ifstream file(filePath, std::ios::binary);
-	if (!file.is_open()) {
-		std::cerr << "* ERROR: Unable to open file: " << filePath << std::endl;
-		return false;
-	}
-
-	file.seekg(160, std::ios::beg);
-	char buffer[3];
-	file.read(buffer, 3);
-	file.close();
-
-	std::stringstream hexStream;
-	for (int i = 0; i < 3; ++i) {
-		hexStream << std::hex << std::setw(2) << std::setfill('0') << (int)(unsigned char)buffer[i];
-	}
-
-	return hexStream.str() == expectedSignature;
-}
+#include "../libgbtex/gbtex.h"
 
-// Function to create output directory
-void createDirectories(const std::string& path) {
-	std::filesystem::create_directories(path);
-}
+const std::string version = "v0.1.0";
+bool quiet = false;	// Quiet mode flag
+bool json = false;	// JSON report mode flag
+std::unique_ptr<gbtex::ConversionStats> stats;	// Stage timings, if --stats or --trace is used
 
 // Function to print the help message
 void printHelpMessage() {
 	std::cout << std::endl;
-	std::cout << "👻 GBTVGR SMP to OGG Converter v0.1.0" << std::endl;
+	std::cout << "👻 GBTVGR SMP to OGG Converter " << version << std::endl;
 	std::cout << std::endl;
 	std::cout << "Usage: smp2ogg <input_file.smp> [options]" << std::endl;
+	std::cout << "       smp2ogg --batch <input_dir|list.txt> [options]" << std::endl;
+	std::cout << "       smp2ogg --inspect <input_dir|list.txt|pack.gbpk> [-o <index.txt>]" << std::endl;
+	std::cout << "       smp2ogg --pack <input_dir|list.txt> -o <pack.gbpk>" << std::endl;
+	std::cout << "       smp2ogg --extract <pack.gbpk> <entry_name.smp> [options]" << std::endl;
 	std::cout << std::endl;
 	std::cout << "Options:" << std::endl;
-	std::cout << "  -i, --input <input_file.dds>		Specify the input SMP file path and name." << std::endl;
-	std::cout << "  -o, --output <output_file.ogg>	Specify the output OGG file path and name." << std::endl;
+	std::cout << "  -i, --input <input_file.dds>		Specify the input SMP file path and name. '-' reads it from standard input." << std::endl;
+	std::cout << "  -o, --output <output_file.ogg>	Specify the output OGG file path and name. '-' writes it to standard output." << std::endl;
+	std::cout << "					In batch mode, specify the output directory." << std::endl;
+	std::cout << "  -b, --batch <input_dir|list.txt>	Convert every SMP file below <input_dir>, or every file listed in <list.txt>." << std::endl;
+	std::cout << "  -j, --jobs <n>			Number of worker threads used in batch mode. Default is the number of CPU cores." << std::endl;
+	std::cout << "  -m, --manifest <manifest.txt>		In batch mode, skip the SMP files unchanged since the run that wrote <manifest.txt>, then update it." << std::endl;
+	std::cout << "  -s, --stats				Print the time spent in every stage of the conversions on exit." << std::endl;
+	std::cout << "  -t, --trace <trace.json>		Save the stages of every conversion to <trace.json>, in Chrome trace-event format." << std::endl;
+	std::cout << "  -I, --inspect <input_dir|list.txt>	Write an index of every SMP file below <input_dir>, or listed in <list.txt>, reading their headers only." << std::endl;
+	std::cout << "					The index is written to the file given with -o, or printed. A pack is indexed from its own index." << std::endl;
+	std::cout << "  -k, --pack <input_dir|list.txt>	Store every SMP file below <input_dir>, or listed in <list.txt>, in the pack file given with -o." << std::endl;
+	std::cout << "  -x, --extract <pack.gbpk>		Convert the entry of <pack.gbpk> named by the input file, instead of a file." << std::endl;
+	std::cout << "  -J, --json				Print a line of JSON describing every converted file instead of the output messages." << std::endl;
 	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
 	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
 	std::cout << std::endl;
@@ -64,17 +62,345 @@ void printHelpMessage() {
 	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
 }
 
+// Function to convert a single SMP file to OGG
+// In an incremental batch run, SMP files whose content didn't change since the last run are skipped.
+// From standard input, the OGG file is streamed through a fixed-size buffer once the header is checked.
+int convertFile(const std::string& inputFile, const std::string& outputFile, gbtex::BatchManifest* manifest, gbtex::FileReport& report) {
+
+	std::string pathTo = std::filesystem::path(outputFile).parent_path().string();
+	gbtex::Digest inputDigest;
+	gbtex::ConversionStats::Clock::time_point started = gbtex::ConversionStats::Clock::now();
+
+	//setConsoleTitleAndPrint("👻 GBTVGR Converter", "👻 GBTVGR SMP to OGG Converter v0.0.1:");
+
+	// Skip the SMP file if its content didn't change since the last run
+	if (manifest) {
+		gbtex::StageTimer hashTimer(stats.get(), "hash", inputFile);
+		gbtex::MappedFile file(inputFile);
+		hashTimer.setBytes(file.size());
+		inputDigest = gbtex::hashBytes(file.span());
+		if (manifest->isUpToDate(inputFile, outputFile, inputDigest)) {
+			report.status = "unchanged";
+			return 0;
+		}
+	}
+
+	// Check if the file has a valid OGG header
+	gbtex::StageTimer checkTimer(stats.get(), "check", inputFile);
+	std::vector<uint8_t> head;
+	uint64_t inputSize = 0;
+	bool streamed = gbtex::isStandardStream(inputFile);
+	if (streamed && !gbtex::readStandardInput(head, gbtex::SMP_HEADER_SIZE + 3)) {
+		std::cerr << "* ERROR: Unable to read standard input" << std::endl;
+		return gbtex::failReport(&report, 1, "io", "Unable to read standard input");
+	} else if (!streamed && !gbtex::readFileHead(inputFile, gbtex::SMP_HEADER_SIZE + 3, head, inputSize)) {
+		std::cerr << "* ERROR: Unable to open file: " << inputFile << std::endl;
+		return gbtex::failReport(&report, 3, "io", "Unable to open file: " + inputFile);
+	}
+	if (head.size() < gbtex::SMP_HEADER_SIZE + 3 || std::memcmp(head.data() + gbtex::SMP_HEADER_SIZE, "Ogg", 3) != 0) {
+		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid SMP!" << std::endl;
+		return gbtex::failReport(&report, 3, gbtex::conversionErrorClass(3), "Not a valid SMP file!");
+	}
+	checkTimer.stop();
+
+	// Create output directory if not exists
+	gbtex::createDirectories(pathTo);
+
+	// Copy the OGG file following the header, inside the kernel where possible
+	gbtex::StageTimer copyTimer(stats.get(), "copy", inputFile);
+	uint64_t copied = 0;
+	bool success = streamed
+		? gbtex::copyStandardInput(gbtex::ByteSpan{head.data() + gbtex::SMP_HEADER_SIZE, head.size() - gbtex::SMP_HEADER_SIZE}, outputFile, copied)
+		: gbtex::copyFileTail(inputFile, gbtex::SMP_HEADER_SIZE, outputFile, copied);
+	if (streamed) {
+		inputSize = gbtex::SMP_HEADER_SIZE + copied;
+	}
+	report.inputBytes = inputSize;
+	if (!success) {
+		std::cerr << "* ERROR: Unable to write output file: " << outputFile << std::endl;
+		return gbtex::failReport(&report, 1, "io", "Unable to write output file: " + outputFile);
+	}
+	copyTimer.setBytes(copied);
+	copyTimer.stop();
+
+	if (stats) {
+		stats->recordFile(inputFile, started, gbtex::ConversionStats::Clock::now(), inputSize);
+	}
+	report.outputBytes = copied;
+
+	if (manifest) {
+		manifest->record(inputFile, outputFile, inputDigest);
+	}
+
+	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
+
+	return 0;
+}
+
+// Function to convert the SMP file named <inputFile> in <pack> to OGG
+// The OGG file is written straight from the mapped pack.
+int convertPackEntry(const gbtex::PackFile& pack, const std::string& inputFile, const std::string& outputFile, gbtex::FileReport& report) {
+
+	std::string pathTo = std::filesystem::path(outputFile).parent_path().string();
+	gbtex::ConversionStats::Clock::time_point started = gbtex::ConversionStats::Clock::now();
+
+	// Look the SMP file up and check if it has a valid OGG header
+	gbtex::StageTimer checkTimer(stats.get(), "check", inputFile);
+	gbtex::PACK_Entry entry;
+	if (!pack.find(inputFile, entry)) {
+		std::cerr << "* ERROR: No entry named \"" << inputFile << "\" in the pack!" << std::endl;
+		return gbtex::failReport(&report, 1, "io", "No entry named \"" + inputFile + "\" in the pack");
+	}
+	gbtex::ByteSpan smpData = pack.entryData(entry);
+	if (smpData.size < gbtex::SMP_HEADER_SIZE + 3 || std::memcmp(smpData.data + gbtex::SMP_HEADER_SIZE, "Ogg", 3) != 0) {
+		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid SMP!" << std::endl;
+		return gbtex::failReport(&report, 3, gbtex::conversionErrorClass(3), "Not a valid SMP file!");
+	}
+	checkTimer.stop();
+	report.inputBytes = smpData.size;
+
+	// Create output directory if not exists
+	gbtex::createDirectories(pathTo);
+
+	// Write the OGG file following the header
+	gbtex::ByteSpan oggData{smpData.data + gbtex::SMP_HEADER_SIZE, smpData.size - gbtex::SMP_HEADER_SIZE};
+	gbtex::StageTimer copyTimer(stats.get(), "copy", inputFile, oggData.size);
+	if (!gbtex::writeFile(outputFile, std::vector<gbtex::ByteSpan>{oggData})) {
+		std::cerr << "* ERROR: Unable to write output file: " << outputFile << std::endl;
+		return gbtex::failReport(&report, 1, "io", "Unable to write output file: " + outputFile);
+	}
+	copyTimer.stop();
+
+	if (stats) {
+		stats->recordFile(inputFile, started, gbtex::ConversionStats::Clock::now(), smpData.size);
+	}
+	report.outputBytes = oggData.size;
+
+	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
+
+	return 0;
+}
+
+// Function to convert every file of a batch, spreading the work across <jobs> threads
+// With a manifest, files unchanged since the run that wrote it are skipped.
+int runBatch(const std::string& batchSource, const std::string& outputDir, unsigned int jobs, const std::string& manifestFile) {
+	std::vector<std::string> files = gbtex::collectBatchFiles(batchSource, ".smp");
+	if (files.empty()) {
+		std::cerr << "* ERROR: No SMP files found in: " << batchSource << std::endl;
+		return 1;
+	}
+
+	std::unique_ptr<gbtex::BatchManifest> manifest;
+	if (!manifestFile.empty()) {
+		manifest.reset(new gbtex::BatchManifest(manifestFile, "smp2ogg " + version));
+		manifest->load();
+	}
+
+	std::atomic<size_t> unchanged(0);
+	std::vector<int> results = gbtex::runBatchJobs(files.size(), jobs, [&](size_t i) {
+		std::string outputFile = gbtex::batchOutputFile(files[i], batchSource, outputDir, ".ogg");
+		return gbtex::runReportedConversion(files[i], outputFile, json, [&](gbtex::FileReport& report) {
+			int result = 0;
+			if (manifest && manifest->isUpToDate(files[i], outputFile)) {
+				report.status = "unchanged";
+			} else {
+				result = convertFile(files[i], outputFile, manifest.get(), report);
+			}
+
+			// Inputs skipped on their digest are unchanged as well
+			if (report.status == "unchanged") {
+				++unchanged;
+			}
+			return result;
+		});
+	});
+
+	if (manifest && !manifest->save()) {
+		std::cerr << "* ERROR: Unable to write manifest: " << manifestFile << std::endl;
+	}
+
+	// Report the exit code of the first failed conversion
+	size_t failed = std::count_if(results.begin(), results.end(), [](int result) { return result != 0; });
+	if (!quiet) {
+		std::cout << "Batch complete: " << files.size() - failed - unchanged << " of " << files.size() << " files converted";
+		if (manifest) std::cout << ", " << unchanged << " unchanged";
+		std::cout << "." << std::endl;
+	}
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
+	}
+	return 0;
+}
+
+// Function to read the header of every file of <files>, spreading the reads across <jobs> threads
+// so that the latency of slow disks overlaps. Returns 0 for every valid SMP, or its exit code.
+std::vector<int> readHeaders(const std::vector<std::string>& files, unsigned int jobs, std::vector<gbtex::SoundInfo>& infos, std::vector<uint64_t>& sizes) {
+	infos.assign(files.size(), gbtex::SoundInfo());
+	sizes.assign(files.size(), 0);
+	return gbtex::runBatchJobs(files.size(), jobs, [&](size_t i) {
+		std::vector<uint8_t> head;
+		if (!gbtex::readFileHead(files[i], gbtex::SMP_INFO_SIZE, head, sizes[i])) {
+			std::cerr << "* ERROR: Unable to open file: " << files[i] << std::endl;
+			return 3;
+		}
+		if (!gbtex::readSmpInfo(gbtex::ByteSpan{head.data(), head.size()}, infos[i])) {
+			std::cerr << "* ERROR: \"" << files[i] << "\" is not a valid SMP!" << std::endl;
+			return 3;
+		}
+		return 0;
+	});
+}
+
+// Function to write an index of every SMP file below <inspectSource>, or listed in it, to <indexFile> (stdout if empty)
+// Only the header of each file is read. A pack is indexed from its own index, without reading its files.
+// The index is a text file: a header line, then one line per SMP sorted by path,
+// "<size>\t<ogg_size>\t<duration_ms>\t<sample_rate>\t<path>"
+int runInspect(const std::string& inspectSource, const std::string& indexFile, unsigned int jobs) {
+	std::vector<std::string> files;
+	std::vector<gbtex::SoundInfo> infos;
+	std::vector<uint64_t> sizes;
+	std::vector<int> results;
+
+	if (gbtex::isPackFile(inspectSource)) {
+		gbtex::PackFile pack(inspectSource);
+		if (!pack.is_open() || pack.kind() != gbtex::PACK_KIND_SMP) {
+			std::cerr << "* ERROR: \"" << inspectSource << "\" is not a valid SMP pack!" << std::endl;
+			return 3;
+		}
+		std::vector<gbtex::PACK_Entry> entries(pack.entryCount());
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (!pack.entry(i, entries[i])) {
+				std::cerr << "* ERROR: \"" << inspectSource << "\" is not a valid SMP pack!" << std::endl;
+				return 3;
+			}
+		}
+		std::sort(entries.begin(), entries.end(), [&pack](const gbtex::PACK_Entry& a, const gbtex::PACK_Entry& b) {
+			return pack.entryName(a) < pack.entryName(b);
+		});
+		for (const gbtex::PACK_Entry& entry : entries) {
+			gbtex::SoundInfo info;
+			info.oggSize = static_cast<uint32_t>(entry.qwSize - std::min<uint64_t>(entry.qwSize, gbtex::SMP_HEADER_SIZE));
+			info.durationMs = entry.dwDuration;
+			info.sampleRate = entry.dwSampleRate;
+			files.push_back(pack.entryName(entry));
+			infos.push_back(info);
+			sizes.push_back(entry.qwSize);
+		}
+		results.assign(files.size(), 0);
+	} else {
+		files = gbtex::collectBatchFiles(inspectSource, ".smp");
+		if (files.empty()) {
+			std::cerr << "* ERROR: No SMP files found in: " << inspectSource << std::endl;
+			return 1;
+		}
+		results = readHeaders(files, jobs, infos, sizes);
+	}
+
+	// Write index
+	std::ofstream indexStream;
+	if (!indexFile.empty()) {
+		gbtex::createDirectories(std::filesystem::path(indexFile).parent_path().string());
+		indexStream.open(indexFile);
+		if (!indexStream.is_open()) {
+			std::cerr << "* ERROR: Unable to open index file: " << indexFile << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = indexFile.empty() ? std::cout : indexStream;
+	out << "# gbtvgr smp index: size, ogg_size, duration_ms, sample_rate, path\n";
+	size_t indexed = 0;
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (results[i] != 0) {
+			continue;
+		}
+		const gbtex::SoundInfo& info = infos[i];
+		out << sizes[i] << "\t" << info.oggSize << "\t" << info.durationMs << "\t" << info.sampleRate << "\t" << files[i] << "\n";
+		++indexed;
+	}
+	out.flush();
+
+	if (!quiet && !indexFile.empty()) {
+		std::cout << "Inspection complete: " << indexed << " of " << files.size() << " files indexed in " << indexFile << "." << std::endl;
+	}
+
+	// Report the exit code of the first unreadable file
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
+	}
+	return 0;
+}
+
+// Function to store every SMP file below <packSource>, or listed in it, in <packFile>
+// The headers are read first to fill the index, then the whole pack is written in a single pass.
+int runPack(const std::string& packSource, const std::string& packFile, unsigned int jobs) {
+	std::vector<std::string> files = gbtex::collectBatchFiles(packSource, ".smp");
+	if (files.empty()) {
+		std::cerr << "* ERROR: No SMP files found in: " << packSource << std::endl;
+		return 1;
+	}
+
+	std::vector<gbtex::SoundInfo> infos;
+	std::vector<uint64_t> sizes;
+	std::vector<int> results = readHeaders(files, jobs, infos, sizes);
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
+	}
+
+	std::vector<gbtex::PackInput> inputs(files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		inputs[i].name = gbtex::packEntryName(files[i], packSource);
+		inputs[i].path = files[i];
+		inputs[i].entry.qwSize = sizes[i];
+		inputs[i].entry.dwDuration = infos[i].durationMs;
+		inputs[i].entry.dwSampleRate = infos[i].sampleRate;
+	}
+
+	gbtex::createDirectories(std::filesystem::path(packFile).parent_path().string());
+	std::string error;
+	int result = gbtex::writePack(packFile, gbtex::PACK_KIND_SMP, inputs, error);
+	if (result != 0) {
+		std::cerr << "* ERROR: " << error << std::endl;
+		return result;
+	}
+
+	if (!quiet) std::cout << "Pack complete: " << files.size() << " files stored in " << packFile << "." << std::endl;
+	return 0;
+}
+
 // Main function
 int main(int argc, char* argv[]) {
 
 	std::string inputFile;
 	std::string outputFile;
+	std::string batchSource;
+	unsigned int jobs = 0;
+	std::string manifestFile;
+	bool printStats = false;
+	std::string traceFile;
+	std::string inspectSource;
+	std::string packSource;
+	std::string extractPack;
 	bool argError = false;
 
 	// Define the long options for getopt
 	struct option long_options[] = {
 		{"input", required_argument, nullptr, 'i'},
 		{"output", required_argument, nullptr, 'o'},
+		{"batch", required_argument, nullptr, 'b'},
+		{"jobs", required_argument, nullptr, 'j'},
+		{"manifest", required_argument, nullptr, 'm'},
+		{"stats", no_argument, nullptr, 's'},
+		{"trace", required_argument, nullptr, 't'},
+		{"json", no_argument, nullptr, 'J'},
+		{"inspect", required_argument, nullptr, 'I'},
+		{"pack", required_argument, nullptr, 'k'},
+		{"extract", required_argument, nullptr, 'x'},
 		{"quiet", no_argument, nullptr, 'q'},
 		{"help", no_argument, nullptr, 'h'},
 		{nullptr, 0, nullptr, 0}	// Terminate the list of options
@@ -83,7 +409,7 @@ int main(int argc, char* argv[]) {
 	// Parse command-line arguments
 	int opt;
 	int option_index = 0;
-	while ((opt = getopt_long(argc, argv, "i:o:qh", long_options, &option_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "i:o:b:j:m:st:JI:k:x:qh", long_options, &option_index)) != -1) {
 		switch (opt) {
 			case 'i':
 				inputFile = optarg;
@@ -91,6 +417,39 @@ int main(int argc, char* argv[]) {
 			case 'o':
 				outputFile = optarg;
 				break;
+			case 'b':
+				batchSource = optarg;
+				break;
+			case 'j':
+				try {
+					jobs = static_cast<unsigned int>(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid number of jobs: " << optarg << std::endl;
+				}
+				break;
+			case 'm':
+				manifestFile = optarg;
+				break;
+			case 's':
+				printStats = true;
+				break;
+			case 't':
+				traceFile = optarg;
+				break;
+			case 'I':
+				inspectSource = optarg;
+				break;
+			case 'k':
+				packSource = optarg;
+				break;
+			case 'x':
+				extractPack = optarg;
+				break;
+			case 'J':
+				json = true;
+				quiet = true;
+				break;
 			case 'q':
 				quiet = true;
 				break;
@@ -106,11 +465,11 @@ int main(int argc, char* argv[]) {
 	// Remaining arguments (positional)
 	for (int i = optind; i < argc; ++i) {
 		std::string arg = argv[i];
-		if (arg.rfind("-", 0) == 0) {
+		if (arg.rfind("-", 0) == 0 && arg != "-") {
 			argError = true;
 			return 1;
 		}
-		if (inputFile.empty()) {
+		if (inputFile.empty() && batchSource.empty() && inspectSource.empty() && packSource.empty()) {
 			inputFile = arg;
 		} else {
 			argError = true;
@@ -119,9 +478,46 @@ int main(int argc, char* argv[]) {
 	}
 
 	// Check if input file is provided
-	if (inputFile.empty()) {
+	if (!inspectSource.empty()) {
+		if (!inputFile.empty() || !batchSource.empty() || !manifestFile.empty() || !packSource.empty() || !extractPack.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Inspect mode can't be combined with an input file, batch mode, a manifest or a pack." << std::endl;
+		}
+	} else if (!packSource.empty()) {
+		if (!inputFile.empty() || !batchSource.empty() || !manifestFile.empty() || !extractPack.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Pack mode can't be combined with an input file, batch mode, a manifest or --extract." << std::endl;
+		} else if (outputFile.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: No output pack file specified." << std::endl;
+		}
+	} else if (!extractPack.empty() && inputFile.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: No entry name specified." << std::endl;
+	} else if (inputFile.empty() && batchSource.empty()) {
 		argError = true;
 		std::cerr << "* ERROR: No input file specified." << std::endl;
+	} else if (!inputFile.empty() && !batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: An input file can't be combined with batch mode." << std::endl;
+	} else if (!manifestFile.empty() && batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: A manifest can only be used in batch mode." << std::endl;
+	}
+
+	// Standard output carries the converted file, so it takes neither messages nor JSON reports
+	if (outputFile.empty() && gbtex::isStandardStream(inputFile)) {
+		outputFile = inputFile;
+	}
+	if (gbtex::isStandardStream(outputFile)) {
+		if (!batchSource.empty() || !packSource.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Only a single file can be written to standard output." << std::endl;
+		} else if (json && inspectSource.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: JSON output can't be combined with writing to standard output." << std::endl;
+		}
+		quiet = true;
 	}
 
 	if (argError) {
@@ -129,48 +525,51 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	// Generate default output file if not provided
-	if (outputFile.empty()) {
-		outputFile = std::filesystem::path(inputFile).replace_extension(".ogg").string();
+	if (!inspectSource.empty()) {
+		return runInspect(inspectSource, gbtex::isStandardStream(outputFile) ? "" : outputFile, jobs);
+	}
+	if (!packSource.empty()) {
+		return runPack(packSource, outputFile, jobs);
 	}
 
-	std::string pathTo = std::filesystem::path(outputFile).parent_path().string();
-	std::string file = std::filesystem::path(outputFile).stem().string();
+	if (printStats || !traceFile.empty()) {
+		stats.reset(new gbtex::ConversionStats(!traceFile.empty()));
+	}
 
-	std::string input = "smp";
-	std::string output = "ogg";
+	int result;
+	if (!batchSource.empty()) {
+		result = runBatch(batchSource, outputFile, jobs, manifestFile);
+	} else if (!extractPack.empty()) {
+		// Generate default output file if not provided, in the current directory
+		if (outputFile.empty()) {
+			outputFile = std::filesystem::path(inputFile).filename().replace_extension(".ogg").string();
+		}
 
-	//setConsoleTitleAndPrint("👻 GBTVGR Converter", "👻 GBTVGR SMP to OGG Converter v0.0.1:");
+		gbtex::PackFile pack(extractPack);
+		if (!pack.is_open() || pack.kind() != gbtex::PACK_KIND_SMP) {
+			std::cerr << "* ERROR: \"" << extractPack << "\" is not a valid SMP pack!" << std::endl;
+			result = 3;
+		} else {
+			result = gbtex::runReportedConversion(inputFile, outputFile, json, [&](gbtex::FileReport& report) {
+				return convertPackEntry(pack, inputFile, outputFile, report);
+			});
+		}
+	} else {
+		// Generate default output file if not provided
+		if (outputFile.empty()) {
+			outputFile = std::filesystem::path(inputFile).replace_extension(".ogg").string();
+		}
 
-	// Check if the file has a valid OGG header
-	if (!checkFileSignature(inputFile, "4f6767")) {
-		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid SMP!" << std::endl;
-		return 3;
+		result = gbtex::runReportedConversion(inputFile, outputFile, json, [&](gbtex::FileReport& report) {
+			return convertFile(inputFile, outputFile, nullptr, report);
+		});
 	}
 
-	// Create output directory if not exists
-	createDirectories(pathTo);
-
-	// Prepare output file
-	std::ofstream outFile(outputFile, std::ios::binary);
-	if (!outFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open output file: " << outputFile << std::endl;
-		return 1;
+	if (printStats) {
+		stats->printSummary(json || gbtex::isStandardStream(outputFile) ? std::cerr : std::cout);
 	}
-
-	// Append the input OGG file
-	std::ifstream inFile(inputFile, std::ios::binary);
-	if (!inFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open input file: " << inputFile << std::endl;
-		return 1;
+	if (!traceFile.empty() && !stats->saveTrace(traceFile)) {
+		std::cerr << "* ERROR: Unable to write trace: " << traceFile << std::endl;
 	}
-	inFile.seekg(160, std::ios::beg);
-	outFile << inFile.rdbuf();
-
-	outFile.close();
-	inFile.close();
-
-	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
-
-	return 0;
+	return result;
 }
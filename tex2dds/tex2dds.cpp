@@ -13,337 +13,540 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <sstream>
-#include <iomanip>
 #include <filesystem>
-#include <cstdio>
 #include <vector>
 #include <getopt.h>
-#include <cstring>
 #include <algorithm>
 #include <stdexcept>
 #include <cstdint>
+#include <atomic>
+#include <memory>
+#include <functional>
 
-typedef uint32_t DWORD;
-typedef uint8_t BYTE;
+#include "../libgbtex/gbtex.h"
 
+using namespace gbtex;
+
+const std::string version = "v0.9.0";
 bool quiet = false;	// Quiet mode flag
+bool json = false;	// JSON report mode flag
+bool lowMemory = false;	// Streamed conversion flag
+std::unique_ptr<ConversionCache> cache;	// Conversion cache, if enabled
+std::unique_ptr<ConversionStats> stats;	// Stage timings, if --stats or --trace is used
+BufferPool ddsBuffers;	// DDS files of finished conversions, reused by the next ones of a batch
 
-#define MAKEFOURCC(ch0, ch1, ch2, ch3) \
-	((DWORD)(BYTE)(ch0) | ((DWORD)(BYTE)(ch1) << 8) | \
-	((DWORD)(BYTE)(ch2) << 16) | ((DWORD)(BYTE)(ch3) << 24 ))
-
-struct DDS_PIXELFORMAT {
-	DWORD dwSize;
-	DWORD dwFlags;
-	DWORD dwFourCC;
-	DWORD dwRGBBitCount;
-	DWORD dwRBitMask;
-	DWORD dwGBitMask;
-	DWORD dwBBitMask;
-	DWORD dwABitMask;
-};
+// Function to print the help message
+void printHelpMessage() {
+	std::cout << std::endl;
+	std::cout << "👻 GBTVGR TEX to DDS Converter " << version << std::endl;
+	std::cout << std::endl;
+	std::cout << "Usage: tex2dds <input_file.tex> [options]" << std::endl;
+	std::cout << "       tex2dds --batch <input_dir|list.txt> [options]" << std::endl;
+	std::cout << "       tex2dds --inspect <input_dir|list.txt|pack.gbpk> [-o <index.txt>]" << std::endl;
+	std::cout << "       tex2dds --pack <input_dir|list.txt> -o <pack.gbpk>" << std::endl;
+	std::cout << "       tex2dds --extract <pack.gbpk> <entry_name.tex> [options]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -i, --input <input_file.dds>		Specify the input TEX file path and name. '-' reads it from standard input." << std::endl;
+	std::cout << "  -o, --output <output_file.dds>	Specify the output DDS file path and name. '-' writes it to standard output." << std::endl;
+	std::cout << "					In batch mode, specify the output directory." << std::endl;
+	std::cout << "  -b, --batch <input_dir|list.txt>	Convert every TEX file below <input_dir>, or every file listed in <list.txt>." << std::endl;
+	std::cout << "  -j, --jobs <n>			Number of worker threads used in batch mode. Default is the number of CPU cores." << std::endl;
+	std::cout << "  -m, --manifest <manifest.txt>		In batch mode, skip the TEX files unchanged since the run that wrote <manifest.txt>, then update it." << std::endl;
+	std::cout << "  -c, --cache <cache_dir>		Reuse the DDS files of previous conversions of the same TEX files, stored in <cache_dir>." << std::endl;
+	std::cout << "  -C, --cache-size <MB>			Size limit of the cache, least recently used conversions are dropped first. Default is 1024." << std::endl;
+	std::cout << "  -l, --low-memory			Write every DDS file one mip level at a time while converting it, instead of building it whole in memory." << std::endl;
+	std::cout << "					Meant for huge textures, can't be combined with a cache." << std::endl;
+	std::cout << "  -s, --stats				Print the time spent in every stage of the conversions on exit." << std::endl;
+	std::cout << "  -t, --trace <trace.json>		Save the stages of every conversion to <trace.json>, in Chrome trace-event format." << std::endl;
+	std::cout << "  -I, --inspect <input_dir|list.txt>	Write an index of every TEX file below <input_dir>, or listed in <list.txt>, reading their headers only." << std::endl;
+	std::cout << "					The index is written to the file given with -o, or printed. A pack is indexed from its own index." << std::endl;
+	std::cout << "  -k, --pack <input_dir|list.txt>	Store every TEX file below <input_dir>, or listed in <list.txt>, in the pack file given with -o." << std::endl;
+	std::cout << "  -x, --extract <pack.gbpk>		Convert the entry of <pack.gbpk> named by the input file, instead of a file." << std::endl;
+	std::cout << "  -J, --json				Print a line of JSON describing every converted file instead of the output messages." << std::endl;
+	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
+	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
+	std::cout << std::endl;
+	std::cout << std::endl;
+	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
+	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
+	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
+	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
+}
 
-constexpr DWORD DDS_MAGIC = 0x20534444;
-constexpr DWORD DDS_FOURCC = 0x00000004;
-constexpr DWORD DDS_RGB = 0x00000040;
-constexpr DWORD DDS_RGBA = 0x00000041;
-constexpr DWORD DDS_LUMINANCE = 0x00020000;
-constexpr DWORD DDS_LUMINANCEA = 0x00020001;
-constexpr DWORD DDS_PF_SIZE = sizeof(DDS_PIXELFORMAT);
-
-// Predefined DDS_PIXELFORMATs
-const DDS_PIXELFORMAT DDSPF_DXT1 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','1'), 0, 0, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_DXT2 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','2'), 0, 0, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_DXT3 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','3'), 0, 0, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_DXT4 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','4'), 0, 0, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_DXT5 = { DDS_PF_SIZE, DDS_FOURCC, MAKEFOURCC('D','X','T','5'), 0, 0, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_A8R8G8B8 = { DDS_PF_SIZE, DDS_RGBA, 0, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 };
-const DDS_PIXELFORMAT DDSPF_R8G8B8A8 = { DDS_PF_SIZE, DDS_RGBA, 0, 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 };
-const DDS_PIXELFORMAT DDSPF_A1R5G5B5 = { DDS_PF_SIZE, DDS_RGBA, 0, 16, 0x00007C00, 0x000003E0, 0x0000001F, 0x00008000 };
-const DDS_PIXELFORMAT DDSPF_A4R4G4B4 = { DDS_PF_SIZE, DDS_RGBA, 0, 16, 0x00000F00, 0x000000F0, 0x0000000F, 0x0000F000 };
-const DDS_PIXELFORMAT DDSPF_R8G8B8 = { DDS_PF_SIZE, DDS_RGB, 0, 24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 };
-const DDS_PIXELFORMAT DDSPF_R5G6B5 = { DDS_PF_SIZE, DDS_RGB, 0, 16, 0x0000F800, 0x000007E0, 0x0000001F, 0x00000000 };
-const DDS_PIXELFORMAT DDSPF_A8L8 = { DDS_PF_SIZE, DDS_LUMINANCEA, 0, 16, 0xFF, 0, 0, 0xFF00 };
-const DDS_PIXELFORMAT DDSPF_L8 = { DDS_PF_SIZE, DDS_LUMINANCE, 0, 8, 0xFF, 0, 0, 0 };
-const DDS_PIXELFORMAT DDSPF_A16B16G16R16F = { DDS_PF_SIZE, DDS_FOURCC, 113, 0, 0, 0, 0, 0 };
-
-constexpr DWORD DDS_HEADER_FLAGS_TEXTURE =	0x00001007;	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT ;
-constexpr DWORD DDS_HEADER_FLAGS_MIPMAP =	0x00020000;	// DDSD_MIPMAPCOUNT;
-constexpr DWORD DDS_HEADER_FLAGS_VOLUME =	0x00800000;	// DDSD_DEPTH;
-constexpr DWORD DDS_HEADER_FLAGS_PITCH =	0x00000008;	// DDSD_PITCH;
-constexpr DWORD DDS_HEADER_FLAGS_LINEARSIZE = 0x00080000;	// DDSD_LINEARSIZE;
-constexpr DWORD DDS_SURFACE_FLAGS_TEXTURE =	0x00001000;	// DDSCAPS_TEXTURE
-constexpr DWORD DDS_SURFACE_FLAGS_MIPMAP =	0x00400008;	// DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
-constexpr DWORD DDS_SURFACE_FLAGS_CUBEMAP =	0x00000008;	// DDSCAPS_COMPLEX
-constexpr DWORD DDS_CUBEMAP_POSITIVEX =		0x00000600;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
-constexpr DWORD DDS_CUBEMAP_NEGATIVEX =		0x00000a00;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
-constexpr DWORD DDS_CUBEMAP_POSITIVEY =		0x00001200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
-constexpr DWORD DDS_CUBEMAP_NEGATIVEY =		0x00002200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
-constexpr DWORD DDS_CUBEMAP_POSITIVEZ =		0x00004200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
-constexpr DWORD DDS_CUBEMAP_NEGATIVEZ =		0x00008200;	// DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
-constexpr DWORD DDS_FLAGS_VOLUME =			0x00200000;	// DDSCAPS2_VOLUME
-
-constexpr DWORD DDS_CUBEMAP_ALLFACES = DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX | \
-										DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY | \
-										DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ;
-
-struct DDS_HEADER
-{
-	DWORD dwSize = 124;
-	DWORD dwHeaderFlags = DDS_HEADER_FLAGS_TEXTURE;
-	DWORD dwHeight = 0;
-	DWORD dwWidth = 0;
-	DWORD dwPitchOrLinearSize = 0;
-	DWORD dwDepth = 0;	// only if DDS_HEADER_FLAGS_VOLUME is set in dwHeaderFlags
-	DWORD dwMipMapCount = 0;
-	DWORD dwReserved1[11] = {};
-	DDS_PIXELFORMAT ddspf = {};
-	DWORD dwSurfaceFlags = DDS_SURFACE_FLAGS_TEXTURE;
-	DWORD dwCubemapFlags = 0;
-	DWORD dwReserved2[3] = {};
+// State of a single TEX to DDS conversion, handed from stage to stage
+struct Conversion {
+	std::string inputFile;
+	std::string outputFile;
+	std::unique_ptr<MappedFile> texFile;
+	std::vector<uint8_t> texBuffer;	// TEX file read from standard input
+	ByteSpan texData;			// The whole TEX file, mapped by readStage() or inside a pack
+	Digest inputDigest;			// Digest of the TEX file, keying the cache and the manifest
+	std::vector<uint8_t> ddsData;
+	uint64_t ddsSize = 0;		// Size of the DDS file, already written by convertStage() in low-memory mode
+	bool written = false;
+	ConversionStats::Clock::time_point started = ConversionStats::Clock::now();
+	uint64_t inputSize = 0;
+	FileReport report;
 };
 
-struct TEX_Header
-{
-	DWORD dwVersion;
-	BYTE bHash[16];
-	DWORD dwUnknown14;
-	DWORD dwFormat;
-	DWORD dwWidth;
-	DWORD dwHeight;
-	DWORD dwUnknown24;
-	DWORD dwMipCount;
-	DWORD dwUnknown2C;
-	DWORD dwUnknown30;
-};
+// Function to start the conversion of <inputFile> to <outputFile>
+void startConversion(Conversion& conversion, const std::string& inputFile, const std::string& outputFile) {
+	conversion.inputFile = inputFile;
+	conversion.outputFile = outputFile;
+	conversion.started = ConversionStats::Clock::now();
+	conversion.report.input = inputFile;
+	conversion.report.output = outputFile;
+}
 
-inline uint32_t swap16(uint16_t val) {
-	return (val << 8) | (val >> 8);
+// Function to print the report of a finished conversion, in JSON mode
+void reportConversion(Conversion& conversion) {
+	if (json) {
+		conversion.report.seconds = std::chrono::duration<double>(ConversionStats::Clock::now() - conversion.started).count();
+		printFileReport(std::cout, conversion.report);
+	}
 }
 
-inline int xgAddress2DTiledX(int blockOffset, int widthInBlocks, int texelBytePitch) {
-	int alignedWidth = (widthInBlocks + 31) & ~31;
-	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
-	int offsetByte = blockOffset << logBpp;
-	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
-	int offsetMacro = offsetTile >> (7 + logBpp);
+// Function to read a TEX file ahead of its conversion
+// In an incremental batch run, TEX files whose content didn't change since the last run are skipped.
+int readStage(Conversion& conversion, BatchManifest* manifest) {
+
+	StageTimer readTimer(stats.get(), "read", conversion.inputFile);
+	if (isStandardStream(conversion.inputFile)) {
+
+		// Read TEX file from standard input, checking its header before the rest of the stream
+		std::vector<uint8_t>& buffer = conversion.texBuffer;
+		TextureInfo info;
+		if (!readStandardInput(buffer, TEXTURE_HEADER_SIZE)) {
+			std::cerr << "* ERROR: Unable to read standard input" << std::endl;
+			return failReport(&conversion.report, 1, "io", "Unable to read standard input");
+		}
+		if (!readTextureInfo(ByteSpan{buffer.data(), buffer.size()}, info) || info.container != "tex") {
+			std::cerr << "* ERROR: Standard input is not a valid TEX!" << std::endl;
+			return failReport(&conversion.report, 3, conversionErrorClass(3), "Not a valid TEX file!");
+		}
+		if (!readStandardInput(buffer, SIZE_MAX)) {
+			std::cerr << "* ERROR: Unable to read standard input" << std::endl;
+			return failReport(&conversion.report, 1, "io", "Unable to read standard input");
+		}
+		conversion.texData = ByteSpan{buffer.data(), buffer.size()};
+	} else {
+
+		// Map TEX file
+		conversion.texFile.reset(new MappedFile(conversion.inputFile));
+		if (!conversion.texFile->is_open()) {
+			std::cerr << "* ERROR: Unable to open file: " << conversion.inputFile << std::endl;
+			return failReport(&conversion.report, 3, "io", "Unable to open file: " + conversion.inputFile);
+		}
+		if (!lowMemory) {
+			conversion.texFile->prefetch();
+		}
+		conversion.texData = conversion.texFile->span();
+	}
+	conversion.inputSize = conversion.texData.size;
+	readTimer.setBytes(conversion.inputSize);
+	readTimer.stop();
 
-	int macroX = (offsetMacro % (alignedWidth >> 5)) << 2;
-	int tile = (((offsetTile >> (5 + logBpp)) & 2) + (offsetByte >> 6)) & 3;
-	int macro = (macroX + tile) << 3;
-	int micro = ((((offsetTile >> 1) & ~0xF) + (offsetTile & 0xF)) & ((texelBytePitch << 3) - 1)) >> logBpp;
+	conversion.report.inputBytes = conversion.inputSize;
+	readTextureInfo(conversion.texData, conversion.report.texture);
 
-	return macro + micro;
+	if (cache || manifest) {
+		StageTimer hashTimer(stats.get(), "hash", conversion.inputFile, conversion.inputSize);
+		conversion.inputDigest = hashBytes(conversion.texData);
+	}
+	if (manifest && manifest->isUpToDate(conversion.inputFile, conversion.outputFile, conversion.inputDigest)) {
+		conversion.texFile.reset();
+		conversion.report.status = "unchanged";
+		return BATCH_SKIP;
+	}
+	return 0;
 }
 
-inline int xgAddress2DTiledY(int blockOffset, int widthInBlocks, int texelBytePitch) {
-	int alignedWidth = (widthInBlocks + 31) & ~31;
-	int logBpp = (texelBytePitch >> 2) + ((texelBytePitch >> 1) >> (texelBytePitch >> 2));
-	int offsetByte = blockOffset << logBpp;
-	int offsetTile = (((offsetByte & ~0xFFF) >> 3) + ((offsetByte & 0x700) >> 2) + (offsetByte & 0x3F));
-	int offsetMacro = offsetTile >> (7 + logBpp);
+// Function to look up the TEX file named <conversion.inputFile> in a pack, in place of readStage()
+int readPackStage(Conversion& conversion, const PackFile& pack) {
+	StageTimer readTimer(stats.get(), "read", conversion.inputFile);
+	PACK_Entry entry;
+	if (!pack.find(conversion.inputFile, entry)) {
+		std::cerr << "* ERROR: No entry named \"" << conversion.inputFile << "\" in the pack!" << std::endl;
+		return failReport(&conversion.report, 1, "io", "No entry named \"" + conversion.inputFile + "\" in the pack");
+	}
+	conversion.texData = pack.entryData(entry);
+	conversion.inputSize = conversion.texData.size;
+	readTimer.setBytes(conversion.inputSize);
+	readTimer.stop();
 
-	int macroY = (offsetMacro / (alignedWidth >> 5)) << 2;
-	int tile = ((offsetTile >> (6 + logBpp)) & 1) + ((offsetByte & 0x800) >> 10);
-	int macro = (macroY + tile) << 3;
-	int micro = (((offsetTile & ((texelBytePitch << 6) - 1 & ~0x1F)) + ((offsetTile & 0xF) << 1)) >> (3 + logBpp)) & ~1;
+	conversion.report.inputBytes = conversion.inputSize;
+	readTextureInfo(conversion.texData, conversion.report.texture);
 
-	return macro + micro + ((offsetTile & 0x10) >> 4);
+	if (cache) {
+		StageTimer hashTimer(stats.get(), "hash", conversion.inputFile, conversion.inputSize);
+		conversion.inputDigest = hashBytes(conversion.texData);
+	}
+	return 0;
 }
 
-void unswizzle_x360(const std::vector<uint8_t>& input, std::vector<uint8_t>& output, int width, int height, int block_pixel_size, int texel_byte_pitch) {
-	const int widthInBlocks = width / block_pixel_size;
-	const int heightInBlocks = height / block_pixel_size;
+// Function to convert a TEX file read by readStage() straight to the DDS file, a mip level at a time
+// Every part of a mapped TEX file is dropped from memory once converted.
+int streamStage(Conversion& conversion) {
+	TexToDdsOptions options;
+	options.stats = stats.get();
+	if (conversion.texFile) {
+		const MappedFile* texFile = conversion.texFile.get();
+		options.releaseInput = [texFile](size_t offset, size_t size) { texFile->release(offset, size); };
+	}
+	OutputFile output(conversion.outputFile);
+	auto sink = [&](ByteSpan data) {
+		conversion.ddsSize += data.size;
+		return output.write(data);
+	};
+
+	std::string error;
+	int result = streamTexToDds(conversion.texData, sink, options, error);
+	bool writeFailed = !output.close();
+	if (result != 0 || writeFailed) {
+		output.discard();
+	}
+	if (writeFailed && !output.created()) {
+		std::cerr << "* ERROR: Unable to open output file: " << conversion.outputFile << std::endl;
+		return failReport(&conversion.report, 1, "io", "Unable to open output file: " + conversion.outputFile);
+	} else if (writeFailed) {
+		std::cerr << "* ERROR: Unable to write output file: " << conversion.outputFile << std::endl;
+		return failReport(&conversion.report, 1, "io", "Unable to write output file: " + conversion.outputFile);
+	} else if (result == 3) {
+		std::cerr << "* ERROR: \"" << conversion.inputFile << "\" is not a valid TEX!" << std::endl;
+		return failReport(&conversion.report, result, conversionErrorClass(result), error);
+	} else if (result != 0) {
+		std::cerr << "* ERROR: " << error << std::endl;
+		return failReport(&conversion.report, result, conversionErrorClass(result), error);
+	}
+	conversion.written = true;
+	return 0;
+}
 
-	std::vector<uint8_t> swapped(input.size());
-	if (input.size() % 2 != 0)
-		throw std::runtime_error("Data size must be a multiple of 2 bytes!");
+// Function to convert a TEX file read by readStage() to DDS
+int convertStage(Conversion& conversion) {
+	StageTimer convertTimer(stats.get(), "convert", conversion.inputFile, conversion.inputSize);
 
-	for (size_t i = 0; i < input.size(); i += 2) {
-		swapped[i]	 = input[i + 1];
-		swapped[i + 1] = input[i];
+	// Reuse a previous conversion of the same TEX file
+	// The DDS file is only built in memory, in a buffer of an earlier conversion, outside of low-memory mode.
+	std::string cacheKey;
+	bool cached = false;
+	if (!lowMemory) {
+		conversion.ddsData = ddsBuffers.acquire();
+	}
+	if (cache) {
+		cacheKey = cache->key(conversion.inputDigest, "tex2dds " + version, "");
+		cached = cache->load(cacheKey, conversion.ddsData);
 	}
 
-	output.resize(input.size());
+	// Convert TEX to DDS
+	if (lowMemory) {
+		int result = streamStage(conversion);
+		if (result != 0) {
+			return result;
+		}
+	} else if (!cached) {
+		TexToDdsOptions options;
+		options.stats = stats.get();
+		std::string error;
+		int result = convertTexToDds(conversion.texData, conversion.ddsData, options, error);
+		if (result == 3) {
+			std::cerr << "* ERROR: \"" << conversion.inputFile << "\" is not a valid TEX!" << std::endl;
+			return failReport(&conversion.report, result, conversionErrorClass(result), error);
+		} else if (result != 0) {
+			std::cerr << "* ERROR: " << error << std::endl;
+			return failReport(&conversion.report, result, conversionErrorClass(result), error);
+		}
+		if (cache) {
+			cache->store(cacheKey, conversion.ddsData);
+		}
+	} else {
+		conversion.report.status = "cached";
+	}
+	if (!conversion.written) {
+		conversion.ddsSize = conversion.ddsData.size();
+	}
 
-	for (int j = 0; j < heightInBlocks; ++j) {
-		for (int i = 0; i < widthInBlocks; ++i) {
-			int blockOffset = j * widthInBlocks + i;
-			int x = xgAddress2DTiledX(blockOffset, widthInBlocks, texel_byte_pitch);
-			int y = xgAddress2DTiledY(blockOffset, widthInBlocks, texel_byte_pitch);
+	// The TEX file is no longer needed once converted
+	conversion.texFile.reset();
+	std::vector<uint8_t>().swap(conversion.texBuffer);
+	conversion.texData = ByteSpan();
+	return 0;
+}
 
-			int srcByteOffset = j * widthInBlocks * texel_byte_pitch + i * texel_byte_pitch;
-			int dstByteOffset = y * widthInBlocks * texel_byte_pitch + x * texel_byte_pitch;
+// Function to write the DDS file of a conversion
+int writeStage(Conversion& conversion, BatchManifest* manifest) {
+	if (!conversion.written) {
 
-			if (dstByteOffset + texel_byte_pitch > output.size() ||
-				srcByteOffset + texel_byte_pitch > swapped.size())
-				continue;
+		// Create output directory if not exists
+		std::string outputPath = std::filesystem::path(conversion.outputFile).parent_path().string();
+		createDirectories(outputPath);
 
-			std::memcpy(&output[dstByteOffset], &swapped[srcByteOffset], texel_byte_pitch);
+		// Write DDS file
+		StageTimer writeTimer(stats.get(), "write", conversion.inputFile, conversion.ddsData.size());
+		if (!writeFile(conversion.outputFile, conversion.ddsData)) {
+			std::cerr << "* ERROR: Unable to open output file: " << conversion.outputFile << std::endl;
+			return failReport(&conversion.report, 1, "io", "Unable to open output file: " + conversion.outputFile);
 		}
+		writeTimer.stop();
+	}
+	conversion.report.outputBytes = conversion.ddsSize;
+	ddsBuffers.release(conversion.ddsData);
+	if (stats) {
+		stats->recordFile(conversion.inputFile, conversion.started, ConversionStats::Clock::now(), conversion.inputSize);
 	}
+
+	if (manifest) {
+		manifest->record(conversion.inputFile, conversion.outputFile, conversion.inputDigest);
+	}
+
+	if (!quiet) std::cout << "Conversion complete: " << conversion.outputFile << std::endl;
+	return 0;
 }
 
-inline size_t calculate_morton_index(size_t t, size_t width, size_t height) {
-	size_t num1 = 1, num2 = 1, num3 = t;
-	size_t t_width = width, t_height = height;
-	size_t num6 = 0, num7 = 0;
+// Function to convert a single TEX file to DDS, read from <pack> if set
+int convertFile(const std::string& inputFile, const std::string& outputFile, const PackFile* pack) {
+	return runReportedConversion(inputFile, outputFile, json, [&](FileReport& report) {
+		Conversion conversion;
+		startConversion(conversion, inputFile, outputFile);
 
-	while (t_width > 1 || t_height > 1) {
-		if (t_width > 1) {
-			num6 += num2 * (num3 & 1);
-			num3 >>= 1;
-			num2 *= 2;
-			t_width >>= 1;
+		int result = pack ? readPackStage(conversion, *pack) : readStage(conversion, nullptr);
+		if (result == 0) {
+			result = convertStage(conversion);
 		}
-		if (t_height > 1) {
-			num7 += num1 * (num3 & 1);
-			num3 >>= 1;
-			num1 *= 2;
-			t_height >>= 1;
+		if (result == 0) {
+			result = writeStage(conversion, nullptr);
 		}
-	}
-
-	return num7 * width + num6;
+		report = conversion.report;
+		return result;
+	});
 }
 
-void unswizzle_morton(const std::vector<uint8_t>& input, std::vector<uint8_t>& output, int width, int height, int bytes_per_pixel, int block_width_height = 1) {
-	int block_size_bytes = bytes_per_pixel * block_width_height * block_width_height;
+// Function to convert every file of a batch
+// TEX files are read by one thread, converted by <jobs> threads and written by another one, so that
+// waiting on the disk overlaps with the conversions. With a manifest, files unchanged since the run
+// that wrote it are skipped.
+int runBatch(const std::string& batchSource, const std::string& outputDir, unsigned int jobs, const std::string& manifestFile) {
+	std::vector<std::string> files = collectBatchFiles(batchSource, ".tex");
+	if (files.empty()) {
+		std::cerr << "* ERROR: No TEX files found in: " << batchSource << std::endl;
+		return 1;
+	}
 
-	int blocks_w = width / block_width_height;
-	int blocks_h = height / block_width_height;
-	int total_blocks = blocks_w * blocks_h;
+	std::unique_ptr<BatchManifest> manifest;
+	if (!manifestFile.empty()) {
+		manifest.reset(new BatchManifest(manifestFile, "tex2dds " + version));
+		manifest->load();
+	}
 
-	output.resize(input.size());
-	size_t source_index = 0;
+	// Function to run a stage, reporting its exceptions as failed conversions
+	// A conversion ending early (failed or unchanged) is reported and released at once.
+	std::vector<Conversion> conversions(files.size());
+	std::atomic<size_t> unchanged(0);
+	auto guarded = [&](size_t i, const std::function<int(Conversion&)>& stage) {
+		int result;
+		try {
+			result = stage(conversions[i]);
+		} catch (const std::exception& e) {
+			std::cerr << "* ERROR: " << files[i] << ": " << e.what() << std::endl;
+			result = failReport(&conversions[i].report, 1, "exception", e.what());
+		}
+		if (result != 0) {
+			if (conversions[i].report.status == "unchanged") {
+				++unchanged;
+			}
+			reportConversion(conversions[i]);
+			ddsBuffers.release(conversions[i].ddsData);
+			conversions[i] = Conversion();
+		}
+		return result;
+	};
 
-	for (int t = 0; t < total_blocks; ++t) {
-		size_t index = calculate_morton_index(t, blocks_w, blocks_h);
-		size_t destination_index = index * block_size_bytes;
+	std::vector<int> results = runBatchPipeline(files.size(), jobs, 0,
+		[&](size_t i) {
+			return guarded(i, [&](Conversion& conversion) {
+				startConversion(conversion, files[i], batchOutputFile(files[i], batchSource, outputDir, ".dds"));
+				if (manifest && manifest->isUpToDate(conversion.inputFile, conversion.outputFile)) {
+					conversion.report.status = "unchanged";
+					return BATCH_SKIP;
+				}
+				return readStage(conversion, manifest.get());
+			});
+		},
+		[&](size_t i) {
+			return guarded(i, convertStage);
+		},
+		[&](size_t i) {
+			int result = guarded(i, [&](Conversion& conversion) { return writeStage(conversion, manifest.get()); });
+			if (result == 0) {
+				reportConversion(conversions[i]);
+			}
+			conversions[i] = Conversion();
+			return result;
+		});
 
-		std::memcpy(&output[destination_index], &input[source_index], block_size_bytes);
+	if (manifest && !manifest->save()) {
+		std::cerr << "* ERROR: Unable to write manifest: " << manifestFile << std::endl;
+	}
 
-		source_index += block_size_bytes;
+	// Report the exit code of the first failed conversion
+	size_t failed = std::count_if(results.begin(), results.end(), [](int result) { return result != 0; });
+	if (!quiet) {
+		std::cout << "Batch complete: " << files.size() - failed - unchanged << " of " << files.size() << " files converted";
+		if (manifest) std::cout << ", " << unchanged << " unchanged";
+		std::cout << "." << std::endl;
+	}
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
 	}
+	return 0;
+}
+
+// Function to read the header of every file of <files>, spreading the reads across <jobs> threads
+// so that the latency of slow disks overlaps. Returns 0 for every valid TEX, or its exit code.
+std::vector<int> readHeaders(const std::vector<std::string>& files, unsigned int jobs, std::vector<TextureInfo>& infos, std::vector<uint64_t>& sizes) {
+	infos.assign(files.size(), TextureInfo());
+	sizes.assign(files.size(), 0);
+	return runBatchJobs(files.size(), jobs, [&](size_t i) {
+		std::vector<uint8_t> head;
+		if (!readFileHead(files[i], TEXTURE_HEADER_SIZE, head, sizes[i])) {
+			std::cerr << "* ERROR: Unable to open file: " << files[i] << std::endl;
+			return 3;
+		}
+		if (!readTextureInfo(ByteSpan{head.data(), head.size()}, infos[i]) || infos[i].container != "tex") {
+			std::cerr << "* ERROR: \"" << files[i] << "\" is not a valid TEX!" << std::endl;
+			return 3;
+		}
+		return 0;
+	});
 }
 
-void unswizzle_switch(
-	const std::vector<uint8_t>& input,
-	std::vector<uint8_t>& output,
-	int img_width,
-	int img_height,
-	int bytes_per_block,
-	int block_height,
-	int width_pad,
-	int height_pad)
-{
-
-	// Resize output buffer
-	output.resize(input.size());
-
-	int width_show = img_width;
-	int height_show = img_height;
-	int width_real = img_width;
-	int height_real = img_height;
-
-	// Pad dimensions to nearest multiple of width_pad / height_pad
-	if (img_width % width_pad != 0 || img_height % height_pad != 0) {
-		width_real = ((img_width + width_pad - 1) / width_pad) * width_pad;
-		height_real = ((img_height + height_pad - 1) / height_pad) * height_pad;
-		img_width = width_real;
-		img_height = height_real;
-	}
-
-	int image_width_in_gobs = img_width * bytes_per_block / 64;
-
-	// Perform unswizzling
-	for (int Y = 0; Y < img_height; ++Y) {
-		for (int X = 0; X < img_width; ++X) {
-			size_t Z = static_cast<size_t>(Y) * img_width + X;
-
-			size_t gob_address =
-				static_cast<size_t>((Y / (8 * block_height)) * 512 * block_height * image_width_in_gobs) +
-				static_cast<size_t>((X * bytes_per_block / 64) * 512 * block_height) +
-				static_cast<size_t>(((Y % (8 * block_height)) / 8) * 512);
-
-			int Xb = X * bytes_per_block;
-
-			size_t address = gob_address
-				+ ((Xb % 64) / 32) * 256
-				+ ((Y % 8) / 2) * 64
-				+ ((Xb % 32) / 16) * 32
-				+ (Y % 2) * 16
-				+ (Xb % 16);
-
-			if (address + bytes_per_block <= input.size() &&
-				Z * bytes_per_block + bytes_per_block <= output.size()) {
-				std::memcpy(&output[Z * bytes_per_block], &input[address], bytes_per_block);
+// Function to write an index of every TEX file below <inspectSource>, or listed in it, to <indexFile> (stdout if empty)
+// Only the header of each file is read. A pack is indexed from its own index, without reading its files.
+// The index is a text file: a header line, then one line per TEX sorted by path,
+// "<size>\t<format>\t<platform>\t<width>\t<height>\t<mips>\t<path>"
+int runInspect(const std::string& inspectSource, const std::string& indexFile, unsigned int jobs) {
+	std::vector<std::string> files;
+	std::vector<TextureInfo> infos;
+	std::vector<uint64_t> sizes;
+	std::vector<int> results;
+
+	if (isPackFile(inspectSource)) {
+		PackFile pack(inspectSource);
+		if (!pack.is_open() || pack.kind() != PACK_KIND_TEX) {
+			std::cerr << "* ERROR: \"" << inspectSource << "\" is not a valid TEX pack!" << std::endl;
+			return 3;
+		}
+		std::vector<PACK_Entry> entries(pack.entryCount());
+		for (size_t i = 0; i < entries.size(); ++i) {
+			if (!pack.entry(i, entries[i])) {
+				std::cerr << "* ERROR: \"" << inspectSource << "\" is not a valid TEX pack!" << std::endl;
+				return 3;
 			}
 		}
+		std::sort(entries.begin(), entries.end(), [&pack](const PACK_Entry& a, const PACK_Entry& b) {
+			return pack.entryName(a) < pack.entryName(b);
+		});
+		for (const PACK_Entry& entry : entries) {
+			TextureInfo info;
+			info.container = "tex";
+			info.texFormat = entry.dwFormat;
+			info.platform = getTexPlatform(entry.dwFormat);
+			info.width = entry.dwWidth;
+			info.height = entry.dwHeight;
+			info.mipLevels = entry.dwMipCount;
+			files.push_back(pack.entryName(entry));
+			infos.push_back(info);
+			sizes.push_back(entry.qwSize);
+		}
+		results.assign(files.size(), 0);
+	} else {
+		files = collectBatchFiles(inspectSource, ".tex");
+		if (files.empty()) {
+			std::cerr << "* ERROR: No TEX files found in: " << inspectSource << std::endl;
+			return 1;
+		}
+		results = readHeaders(files, jobs, infos, sizes);
 	}
 
-	// Crop if dimensions were padded
-	if (width_show != width_real || height_show != height_real) {
-		std::vector<uint8_t> cropped(width_show * height_show * bytes_per_block);
+	// Write index
+	std::ofstream indexStream;
+	if (!indexFile.empty()) {
+		createDirectories(std::filesystem::path(indexFile).parent_path().string());
+		indexStream.open(indexFile);
+		if (!indexStream.is_open()) {
+			std::cerr << "* ERROR: Unable to open index file: " << indexFile << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = indexFile.empty() ? std::cout : indexStream;
+	out << "# gbtvgr tex index: size, format, platform, width, height, mips, path\n";
+	size_t indexed = 0;
+	for (size_t i = 0; i < files.size(); ++i) {
+		if (results[i] != 0) {
+			continue;
+		}
+		const TextureInfo& info = infos[i];
+		out << sizes[i] << "\t" << info.texFormat << "\t" << (info.platform.empty() ? "-" : info.platform) << "\t"
+			<< info.width << "\t" << info.height << "\t" << info.mipLevels << "\t" << files[i] << "\n";
+		++indexed;
+	}
+	out.flush();
 
-		for (int Y = 0; Y < height_show; ++Y) {
-			size_t offset_in = static_cast<size_t>(Y) * width_real * bytes_per_block;
-			size_t offset_out = static_cast<size_t>(Y) * width_show * bytes_per_block;
+	if (!quiet && !indexFile.empty()) {
+		std::cout << "Inspection complete: " << indexed << " of " << files.size() << " files indexed in " << indexFile << "." << std::endl;
+	}
 
-			if (offset_in + width_show * bytes_per_block <= output.size() &&
-				offset_out + width_show * bytes_per_block <= cropped.size()) {
-				std::memcpy(&cropped[offset_out], &output[offset_in], width_show * bytes_per_block);
-			}
+	// Report the exit code of the first unreadable file
+	for (int result : results) {
+		if (result != 0) {
+			return result;
 		}
-
-		output.swap(cropped);
 	}
+	return 0;
 }
 
-// Function to validate the input file
-bool checkFileSignature(const std::string& filePath, const std::string& expectedSignature) {
-	std::ifstream file(filePath, std::ios::binary);
-	if (!file.is_open()) {
-		std::cerr << "* ERROR: Unable to open file: " << filePath << std::endl;
-		return false;
+// Function to store every TEX file below <packSource>, or listed in it, in <packFile>
+// The headers are read first to fill the index, then the whole pack is written in a single pass.
+int runPack(const std::string& packSource, const std::string& packFile, unsigned int jobs) {
+	std::vector<std::string> files = collectBatchFiles(packSource, ".tex");
+	if (files.empty()) {
+		std::cerr << "* ERROR: No TEX files found in: " << packSource << std::endl;
+		return 1;
 	}
 
-	char buffer[4];
-	file.read(buffer, 4);
-	file.close();
-
-	std::stringstream hexStream;
-	for (int i = 0; i < 4; ++i) {
-		hexStream << std::hex << std::setw(2) << std::setfill('0') << (int)(unsigned char)buffer[i];
+	std::vector<TextureInfo> infos;
+	std::vector<uint64_t> sizes;
+	std::vector<int> results = readHeaders(files, jobs, infos, sizes);
+	for (int result : results) {
+		if (result != 0) {
+			return result;
+		}
 	}
 
-	return hexStream.str() == expectedSignature;
-}
+	std::vector<PackInput> inputs(files.size());
+	for (size_t i = 0; i < files.size(); ++i) {
+		inputs[i].name = packEntryName(files[i], packSource);
+		inputs[i].path = files[i];
+		inputs[i].entry.qwSize = sizes[i];
+		inputs[i].entry.dwFormat = infos[i].texFormat;
+		inputs[i].entry.dwWidth = infos[i].width;
+		inputs[i].entry.dwHeight = infos[i].height;
+		inputs[i].entry.dwMipCount = infos[i].mipLevels;
+	}
 
-// Function to create output directory
-void createDirectories(const std::string& path) {
-	std::filesystem::create_directories(path);
-}
+	createDirectories(std::filesystem::path(packFile).parent_path().string());
+	std::string error;
+	int result = writePack(packFile, PACK_KIND_TEX, inputs, error);
+	if (result != 0) {
+		std::cerr << "* ERROR: " << error << std::endl;
+		return result;
+	}
 
-// Function to print the help message
-void printHelpMessage() {
-	std::cout << std::endl;
-	std::cout << "👻 GBTVGR TEX to DDS Converter v0.7.0" << std::endl;
-	std::cout << std::endl;
-	std::cout << "Usage: tex2dds <input_file.tex> [options]" << std::endl;
-	std::cout << std::endl;
-	std::cout << "Options:" << std::endl;
-	std::cout << "  -i, --input <input_file.dds>		Specify the input TEX file path and name." << std::endl;
-	std::cout << "  -o, --output <output_file.dds>	Specify the output DDS file path and name." << std::endl;
-	std::cout << "  -q, --quiet				Disable output messages." << std::endl;
-	std::cout << "  -h, --help				Show this help message and exit." << std::endl;
-	std::cout << std::endl;
-	std::cout << std::endl;
-	std::cout << "Copyright © 2025 KeyofBlueS: <https://github.com/KeyofBlueS>." << std::endl;
-	std::cout << "License GPLv3+: GNU GPL version 3 or later <https://gnu.org/licenses/gpl.html>." << std::endl;
-	std::cout << "This is free software: you are free to change and redistribute it." << std::endl;
-	std::cout << "There is NO WARRANTY, to the extent permitted by law." << std::endl;
+	if (!quiet) std::cout << "Pack complete: " << files.size() << " files stored in " << packFile << "." << std::endl;
+	return 0;
 }
 
 // Main function
@@ -351,12 +554,34 @@ int main(int argc, char* argv[]) {
 
 	std::string inputFile;
 	std::string outputFile;
+	std::string batchSource;
+	unsigned int jobs = 0;
+	std::string cacheDir;
+	uint64_t cacheSize = 1024;
+	std::string manifestFile;
+	bool printStats = false;
+	std::string traceFile;
+	std::string inspectSource;
+	std::string packSource;
+	std::string extractPack;
 	bool argError = false;
 
 	// Define the long options for getopt
 	struct option long_options[] = {
 		{"input", required_argument, nullptr, 'i'},
 		{"output", required_argument, nullptr, 'o'},
+		{"batch", required_argument, nullptr, 'b'},
+		{"jobs", required_argument, nullptr, 'j'},
+		{"manifest", required_argument, nullptr, 'm'},
+		{"cache", required_argument, nullptr, 'c'},
+		{"cache-size", required_argument, nullptr, 'C'},
+		{"low-memory", no_argument, nullptr, 'l'},
+		{"stats", no_argument, nullptr, 's'},
+		{"trace", required_argument, nullptr, 't'},
+		{"json", no_argument, nullptr, 'J'},
+		{"inspect", required_argument, nullptr, 'I'},
+		{"pack", required_argument, nullptr, 'k'},
+		{"extract", required_argument, nullptr, 'x'},
 		{"quiet", no_argument, nullptr, 'q'},
 		{"help", no_argument, nullptr, 'h'},
 		{nullptr, 0, nullptr, 0}	// Terminate the list of options
@@ -365,7 +590,7 @@ int main(int argc, char* argv[]) {
 	// Parse command-line arguments
 	int opt;
 	int option_index = 0;
-	while ((opt = getopt_long(argc, argv, "i:o:qh", long_options, &option_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "i:o:b:j:m:c:C:lst:JI:k:x:qh", long_options, &option_index)) != -1) {
 		switch (opt) {
 			case 'i':
 				inputFile = optarg;
@@ -373,6 +598,53 @@ int main(int argc, char* argv[]) {
 			case 'o':
 				outputFile = optarg;
 				break;
+			case 'b':
+				batchSource = optarg;
+				break;
+			case 'j':
+				try {
+					jobs = static_cast<unsigned int>(std::stoul(optarg));
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid number of jobs: " << optarg << std::endl;
+				}
+				break;
+			case 'm':
+				manifestFile = optarg;
+				break;
+			case 'c':
+				cacheDir = optarg;
+				break;
+			case 'C':
+				try {
+					cacheSize = std::stoull(optarg);
+				} catch (const std::exception&) {
+					argError = true;
+					std::cerr << "* ERROR: Invalid cache size: " << optarg << std::endl;
+				}
+				break;
+			case 'l':
+				lowMemory = true;
+				break;
+			case 's':
+				printStats = true;
+				break;
+			case 't':
+				traceFile = optarg;
+				break;
+			case 'I':
+				inspectSource = optarg;
+				break;
+			case 'k':
+				packSource = optarg;
+				break;
+			case 'x':
+				extractPack = optarg;
+				break;
+			case 'J':
+				json = true;
+				quiet = true;
+				break;
 			case 'q':
 				quiet = true;
 				break;
@@ -388,11 +660,11 @@ int main(int argc, char* argv[]) {
 	// Remaining arguments (positional)
 	for (int i = optind; i < argc; ++i) {
 		std::string arg = argv[i];
-		if (arg.rfind("-", 0) == 0) {
+		if (arg.rfind("-", 0) == 0 && arg != "-") {
 			argError = true;
 			return 1;
 		}
-		if (inputFile.empty()) {
+		if (inputFile.empty() && batchSource.empty() && inspectSource.empty() && packSource.empty()) {
 			inputFile = arg;
 		} else {
 			argError = true;
@@ -401,9 +673,49 @@ int main(int argc, char* argv[]) {
 	}
 
 	// Check if input file is provided
-	if (inputFile.empty()) {
+	if (!inspectSource.empty()) {
+		if (!inputFile.empty() || !batchSource.empty() || !manifestFile.empty() || !packSource.empty() || !extractPack.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Inspect mode can't be combined with an input file, batch mode, a manifest or a pack." << std::endl;
+		}
+	} else if (!packSource.empty()) {
+		if (!inputFile.empty() || !batchSource.empty() || !manifestFile.empty() || !extractPack.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Pack mode can't be combined with an input file, batch mode, a manifest or --extract." << std::endl;
+		} else if (outputFile.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: No output pack file specified." << std::endl;
+		}
+	} else if (!extractPack.empty() && inputFile.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: No entry name specified." << std::endl;
+	} else if (inputFile.empty() && batchSource.empty()) {
 		argError = true;
 		std::cerr << "* ERROR: No input file specified." << std::endl;
+	} else if (!inputFile.empty() && !batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: An input file can't be combined with batch mode." << std::endl;
+	} else if (!manifestFile.empty() && batchSource.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: A manifest can only be used in batch mode." << std::endl;
+	} else if (lowMemory && !cacheDir.empty()) {
+		argError = true;
+		std::cerr << "* ERROR: Low-memory mode can't be combined with a cache." << std::endl;
+	}
+
+	// Standard output carries the converted file, so it takes neither messages nor JSON reports
+	if (outputFile.empty() && isStandardStream(inputFile)) {
+		outputFile = inputFile;
+	}
+	if (isStandardStream(outputFile)) {
+		if (!batchSource.empty() || !packSource.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: Only a single file can be written to standard output." << std::endl;
+		} else if (json && inspectSource.empty()) {
+			argError = true;
+			std::cerr << "* ERROR: JSON output can't be combined with writing to standard output." << std::endl;
+		}
+		quiet = true;
 	}
 
 	if (argError) {
@@ -411,236 +723,51 @@ int main(int argc, char* argv[]) {
 		return 1;
 	}
 
-	// Generate default output file if not provided
-	if (outputFile.empty()) {
-		outputFile = std::filesystem::path(inputFile).replace_extension(".dds").string();
+	if (!inspectSource.empty()) {
+		return runInspect(inspectSource, isStandardStream(outputFile) ? "" : outputFile, jobs);
 	}
-
-	std::string pathTo = std::filesystem::path(outputFile).parent_path().string();
-	std::string file = std::filesystem::path(outputFile).stem().string();
-
-	std::string input = "tex";
-	std::string output = "dds";
-
-	// Check if the file has a valid TEX header
-	if (!checkFileSignature(inputFile, "07000000")) {
-		std::cerr << "* ERROR: \"" << inputFile << "\" is not a valid TEX!" << std::endl;
-		return 3;
+	if (!packSource.empty()) {
+		return runPack(packSource, outputFile, jobs);
 	}
 
-	// Convert TEX to DDS
-	// Open TEX file
-	std::ifstream texFile(inputFile, std::ios::binary);
-	if (!texFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open input file: " << inputFile << std::endl;
-		return 1;
+	if (!cacheDir.empty()) {
+		cache.reset(new ConversionCache(cacheDir, cacheSize * 1024 * 1024));
 	}
 
-	// Read TEX header
-	TEX_Header texHeader;
-	texFile.read(reinterpret_cast<char*>(&texHeader), sizeof(TEX_Header));
-
-	// Determine file size
-	texFile.seekg(0, std::ios::end);
-	//size_t fileSize = texFile.tellg() - sizeof(TEX_Header);
-	size_t fileSize = static_cast<size_t>(texFile.tellg()) - sizeof(TEX_Header);
-	texFile.seekg(sizeof(TEX_Header), std::ios::beg);
-
-	// Read TEX data
-	std::vector<char> texData(fileSize);
-	texFile.read(texData.data(), fileSize);
-	texFile.close();
-
-	// Populate DDS header
-	DDS_HEADER ddsHeader;
-	ddsHeader.dwHeight = texHeader.dwHeight;
-	ddsHeader.dwWidth = texHeader.dwWidth;
-
-	if (texHeader.dwMipCount > 0) {
-		ddsHeader.dwHeaderFlags |= 0x00020000;	// DDS_HEADER_FLAGS_MIPMAP
-		ddsHeader.dwMipMapCount = texHeader.dwMipCount + 1;
-		ddsHeader.dwSurfaceFlags |= 0x00400008;	// DDS_SURFACE_FLAGS_MIPMAP
-	}
-
-	switch (texHeader.dwFormat) {
-	case 0x03:	// PC
-	case 0x27:	// PS3
-		ddsHeader.ddspf = DDSPF_A8R8G8B8;
-		break;
-	case 0x16:	// XBOX360
-	case 0x41:	// SWITCH
-		ddsHeader.ddspf = DDSPF_R8G8B8A8;
-		ddsHeader.dwPitchOrLinearSize = texHeader.dwWidth * 4; // 4 bytes per pixel
-		break;
-	case 0x04:	// PC
-		ddsHeader.ddspf = DDSPF_R5G6B5;
-		break;
-	case 0x05:	// PC
-		ddsHeader.ddspf = DDSPF_A4R4G4B4;
-		break;
-	case 0x17:	// PC
-		ddsHeader.ddspf = DDSPF_DXT3;
-		break;
-	case 0x2B:	// PC
-	case 0x2C:	// PS3
-	case 0x28:	// XBOX360
-		ddsHeader.ddspf = DDSPF_DXT1;
-		break;
-	case 0x18:	// PC
-	case 0x26:	// PS3
-	case 0x36:	// XBOX360
-	case 0x1b:	// XBOX360
-		ddsHeader.ddspf = DDSPF_A8R8G8B8;
-		ddsHeader.dwSurfaceFlags |= DDS_SURFACE_FLAGS_CUBEMAP;
-		ddsHeader.dwCubemapFlags = DDS_CUBEMAP_ALLFACES;
-		break;
-	case 0x2E:
-		ddsHeader.ddspf = DDSPF_A16B16G16R16F;
-		break;
-	case 0x2F:	// PC
-	case 0x31:	// PS3
-	case 0x30:	// XBOX360
-		ddsHeader.ddspf = DDSPF_A8L8;
-		break;
-	case 0x32:	// PC
-	case 0x34:	// PS3
-	case 0x33:	// XBOX360
-		ddsHeader.ddspf = DDSPF_DXT5;
-		break;
-	case 0x37:	// PC
-		ddsHeader.ddspf = DDSPF_L8;
-		break;
-	case 0x40:	// SWITCH
-	case 0x3F:	// SWITCH
-	case 0x3D:	// SWITCH
-	case 0x3C:	// SWITCH
-	case 0x3E:	// SWITCH
-		std::cerr << "* ERROR: Unsupported Nintendo Switch TEX format: " << texHeader.dwFormat << std::endl;
-		return 1;
-		default:
-			std::cerr << "* ERROR: Unsupported TEX format: " << texHeader.dwFormat << std::endl;
-			return 1;
+	if (printStats || !traceFile.empty()) {
+		stats.reset(new ConversionStats(!traceFile.empty()));
 	}
 
-	bool needsUnswizzle = false;
-	std::string swizzleType;
-	int blockWidthHeight;
-	int blockPixelSize;
-	int texelBytePitch;
-	bool convertToRGBA = false;
-
-	int bytes_per_block = 4;
-	int block_height = 8;
-	int width_pad = 8;
-	int height_pad = 8;
-
-	switch (texHeader.dwFormat) {
-	case 0x27:	// PS3 OK
-		needsUnswizzle = true;
-		swizzleType = "morton";
-		blockWidthHeight = 1;
-		break;
-	case 0x16:	// XBOX360
-		needsUnswizzle = true;
-		swizzleType = "x360";
-		blockPixelSize = 1;
-		texelBytePitch = 4;
-		convertToRGBA = true;
-		break;
-	case 0x3C:	// SWITCH
-	case 0x3D:	// SWITCH
-	case 0x3E:	// SWITCH
-	case 0x3F:	// SWITCH
-	case 0x40:	// SWITCH
-	case 0x41:	// SWITCH
-		needsUnswizzle = true;
-		swizzleType = "switch";
-		bytes_per_block = 4;
-		block_height = 16;
-		width_pad = 8;
-		height_pad = 8;
-		break;
-	case 0x28:	// XBOX360
-		needsUnswizzle = true;
-		swizzleType = "x360";
-		blockPixelSize = 4;
-		texelBytePitch = 8;
-		break;
-	case 0x26:	// PS3
-	case 0x36:	// XBOX360
-	case 0x1b:	// XBOX360
-		needsUnswizzle = true;
-		swizzleType = "morton";
-		blockWidthHeight = 1;
-		break;
-	case 0x31:	// PS3
-		needsUnswizzle = true;
-		swizzleType = "morton";
-		blockWidthHeight = 1;
-		break;
-	case 0x30:	// XBOX360
-		needsUnswizzle = true;
-		swizzleType = "x360";
-		blockPixelSize = 1;
-		texelBytePitch = 2;
-		break;
-	case 0x33:	// XBOX360
-		needsUnswizzle = true;
-		swizzleType = "x360";
-		blockPixelSize = 4;
-		texelBytePitch = 16;
-		break;
-	}
-
-	// Create output directory if not exists
-	std::string outputPath = std::filesystem::path(outputFile).parent_path().string();
-	createDirectories(outputPath);
-
-	// Open DDS file for writing
-	std::ofstream ddsFile(outputFile, std::ios::binary);
-	if (!ddsFile.is_open()) {
-		std::cerr << "* ERROR: Unable to open output file: " << outputFile << std::endl;
-		return 1;
-	}
+	int result;
+	if (!batchSource.empty()) {
+		result = runBatch(batchSource, outputFile, jobs, manifestFile);
+	} else if (!extractPack.empty()) {
+		// Generate default output file if not provided, in the current directory
+		if (outputFile.empty()) {
+			outputFile = std::filesystem::path(inputFile).filename().replace_extension(".dds").string();
+		}
 
-	if (needsUnswizzle) {
-		std::vector<uint8_t> unswizzled(texData.size());
-		if (swizzleType == "x360") {
-			unswizzle_x360(reinterpret_cast<const std::vector<uint8_t>&>(texData), unswizzled, texHeader.dwWidth, texHeader.dwHeight, blockPixelSize, texelBytePitch);
-		} else if (swizzleType == "morton") {
-			int bytesPerPixel = (ddsHeader.ddspf.dwRGBBitCount + 7) / 8;
-			unswizzle_morton(reinterpret_cast<const std::vector<uint8_t>&>(texData), unswizzled, texHeader.dwWidth, texHeader.dwHeight, bytesPerPixel, blockWidthHeight);
-			for (size_t i = 0; i + 1 < unswizzled.size(); i += bytesPerPixel) {
-				std::reverse(unswizzled.begin() + i, unswizzled.begin() + i + bytesPerPixel);
-			}
-		} else if (swizzleType == "switch") {
-			unswizzle_switch(reinterpret_cast<const std::vector<uint8_t>&>(texData), unswizzled, texHeader.dwWidth, texHeader.dwHeight, bytes_per_block, block_height, width_pad, height_pad);
-		}
-		texData = std::vector<char>(unswizzled.begin(), unswizzled.end());
-		if (convertToRGBA) {
-			switch (texHeader.dwFormat) {
-			case 0x16:	// XBOX360
-				for (size_t i = 0; i + 3 < texData.size(); i += 4) {
-					uint8_t a = static_cast<uint8_t>(texData[i + 1]);
-					uint8_t r = static_cast<uint8_t>(texData[i + 0]);
-					uint8_t g = static_cast<uint8_t>(texData[i + 2]);
-					uint8_t b = static_cast<uint8_t>(texData[i + 3]);
-					texData[i + 0] = r;
-					texData[i + 1] = g;
-					texData[i + 2] = b;
-					texData[i + 3] = a;
-				}
-				break;
-			}
+		PackFile pack(extractPack);
+		if (!pack.is_open() || pack.kind() != PACK_KIND_TEX) {
+			std::cerr << "* ERROR: \"" << extractPack << "\" is not a valid TEX pack!" << std::endl;
+			result = 3;
+		} else {
+			result = convertFile(inputFile, outputFile, &pack);
+		}
+	} else {
+		// Generate default output file if not provided
+		if (outputFile.empty()) {
+			outputFile = std::filesystem::path(inputFile).replace_extension(".dds").string();
 		}
-	}
 
-	// Write DDS file contents
-	ddsFile.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DWORD));
-	ddsFile.write(reinterpret_cast<const char*>(&ddsHeader), sizeof(DDS_HEADER));
-	ddsFile.write(texData.data(), fileSize);
-	ddsFile.close();
+		result = convertFile(inputFile, outputFile, nullptr);
+	}
 
-	if (!quiet) std::cout << "Conversion complete: " << outputFile << std::endl;
-	return 0;
+	if (printStats) {
+		stats->printSummary(json || isStandardStream(outputFile) ? std::cerr : std::cout);
+	}
+	if (!traceFile.empty() && !stats->saveTrace(traceFile)) {
+		std::cerr << "* ERROR: Unable to write trace: " << traceFile << std::endl;
+	}
+	return result;
 }